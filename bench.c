@@ -0,0 +1,358 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h> // isnan
+
+#include <fcntl.h> // open, posix_fadvise
+#include <unistd.h> // sysconf, close
+#include <getopt.h> // getopt_long
+#include <sys/stat.h> // stat for the input size
+#include <sys/resource.h> // getrusage for user and system time
+
+#include "io_backend.h"
+#include "stats.h"
+#include "weather_station.h"
+
+// runs each backend N times on one input and reports the median and spread, replaces
+// the one off clock() numbers, clock() is cpu time and hides both threads and io waits
+
+typedef struct RunSample {
+    double wall;
+    double user;
+    double sys;
+    double minorFaults;
+    double majorFaults;
+    double perf[PERF_EVENT_COUNT]; // with --perf, NAN for what the host doesn't count
+} RunSample;
+
+static double timespecSeconds(struct timespec t) {
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double timevalSeconds(struct timeval t) {
+    return t.tv_sec + t.tv_usec / 1e6;
+}
+
+static int cmpDouble(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double* values, int count) {
+    qsort(values, count, sizeof(double), cmpDouble);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+// median of one perf event over the runs, NAN when any run lacked it
+static double medianPerf(const RunSample* samples, int runs, int event, double* values) {
+    for (int r = 0; r < runs; r++) {
+        if (isnan(samples[r].perf[event])) return NAN;
+        values[r] = samples[r].perf[event];
+    }
+    return median(values, runs);
+}
+
+// the --perf columns, an empty field for a counter the host doesn't have
+static void printPerfColumns(FILE* csv, const RunSample* samples, int runs, double* values, double rows, double bytes) {
+    double medians[PERF_EVENT_COUNT];
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) medians[e] = medianPerf(samples, runs, e, values);
+
+    double derived[] = { medians[PERF_INSTRUCTIONS] / medians[PERF_CYCLES], medians[PERF_CYCLES] / bytes };
+    for (size_t i = 0; i < sizeof(derived) / sizeof(derived[0]); i++) {
+        if (isnan(derived[i])) fprintf(csv, ",");
+        else fprintf(csv, ",%.4f", derived[i]);
+    }
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (isnan(medians[e])) fprintf(csv, ",");
+        else fprintf(csv, ",%.4f", medians[e] / rows);
+    }
+}
+
+// drops the input's clean pages from the page cache so the next run reads from disk
+static int dropFromPageCache(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("open failed");
+        return 1;
+    }
+    int ret = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    if (ret != 0) {
+        fprintf(stderr, "posix_fadvise: %s\n", strerror(ret));
+        return 1;
+    }
+    return 0;
+}
+
+// one full aggregation, the table is thrown away, rows comes from the summed counts
+// with a prototype (a dictionary or percentiles) every run starts from a copy of its names,
+// perfect index and percentile mode
+static int runOnce(const IoBackend* backend, const IoOptions* options, const WeatherStation* prototype, int perf, RunSample* sample, uint64_t* rows) {
+    WeatherStation ws;
+    if (prototype != NULL) {
+        initWeatherStationLike(&ws, prototype);
+    } else {
+        initWeatherStation(&ws, STATION_TABLE_CAPACITY);
+    }
+
+    // fresh counters every run, they only count while the backend is in its scan phase
+    if (perf) {
+        openPerfCounters(0);
+    }
+
+    struct rusage usageBefore, usageAfter;
+    struct timespec start, end;
+    getrusage(RUSAGE_SELF, &usageBefore);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int failed = backend->run(options, &ws);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    getrusage(RUSAGE_SELF, &usageAfter);
+
+    sample->wall = timespecSeconds(end) - timespecSeconds(start);
+    sample->user = timevalSeconds(usageAfter.ru_utime) - timevalSeconds(usageBefore.ru_utime);
+    sample->sys = timevalSeconds(usageAfter.ru_stime) - timevalSeconds(usageBefore.ru_stime);
+    sample->minorFaults = usageAfter.ru_minflt - usageBefore.ru_minflt;
+    sample->majorFaults = usageAfter.ru_majflt - usageBefore.ru_majflt;
+    if (perf) {
+        readPerfCounters(sample->perf);
+        closePerfCounters();
+    }
+
+    *rows = countRecords(&ws);
+
+    freeWeatherStation(&ws);
+    return failed;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--io=name,name,...] [--runs=N] [--cache=warm|cold] [--threads=N] [--queue-depth=N] [--populate] [--madvise=hints] [--prefault] [--chunk-size=BYTES] [--thread-stats] [--dict=FILE] [--percentiles] [--perf] [--csv=FILE] <input>\n", prog);
+    fprintf(stderr, "backends:");
+    for (size_t i = 0; i < ioBackendCount; i++) {
+        fprintf(stderr, " %s", ioBackends[i]->name);
+    }
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char* argv[]) {
+    IoOptions options = {
+        .path = NULL,
+        .threads = sysconf(_SC_NPROCESSORS_ONLN),
+        .queueDepth = 8,
+        .chunkSize = IO_CHUNK_SIZE,
+    };
+    char* backendList = NULL; // every backend when not given
+    int runs = 5;
+    int cold = 0;
+    const char* csvPath = NULL;
+    const char* dictPath = NULL;
+    int perf = 0;
+    int percentiles = 0;
+
+    static struct option longOptions[] = {
+        {"io", required_argument, NULL, 'i'},
+        {"runs", required_argument, NULL, 'n'},
+        {"cache", required_argument, NULL, 'c'},
+        {"threads", required_argument, NULL, 't'},
+        {"queue-depth", required_argument, NULL, 'q'},
+        {"csv", required_argument, NULL, 'o'},
+        {"populate", no_argument, NULL, 'P'},
+        {"madvise", required_argument, NULL, 'M'},
+        {"prefault", no_argument, NULL, 'F'},
+        {"chunk-size", required_argument, NULL, 'C'},
+        {"thread-stats", no_argument, NULL, 'S'},
+        {"dict", required_argument, NULL, 'D'},
+        {"perf", no_argument, NULL, 'p'},
+        {"percentiles", no_argument, NULL, 'Q'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:n:c:t:q:o:", longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'i':
+            backendList = optarg;
+            break;
+        case 'n':
+            runs = (int)strtol(optarg, NULL, 10);
+            break;
+        case 'c':
+            if (strcmp(optarg, "cold") == 0) {
+                cold = 1;
+            } else if (strcmp(optarg, "warm") != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 't':
+            options.threads = strtol(optarg, NULL, 10);
+            break;
+        case 'q':
+            options.queueDepth = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            csvPath = optarg;
+            break;
+        case 'P':
+            options.mapPopulate = 1;
+            break;
+        case 'M':
+            if (parseMadviseHints(optarg, &options.madviseHints) != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'F':
+            options.prefault = 1;
+            break;
+        case 'C':
+            options.chunkSize = strtoull(optarg, NULL, 10);
+            break;
+        case 'S':
+            options.threadStats = 1;
+            break;
+        case 'D':
+            dictPath = optarg;
+            break;
+        case 'p':
+            perf = 1;
+            break;
+        case 'Q':
+            percentiles = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || runs < 1 || options.threads < 1 || options.queueDepth < 1 || options.chunkSize < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    options.path = argv[optind];
+
+    struct stat st;
+    if (stat(options.path, &st) < 0) {
+        perror("stat failed");
+        return 1;
+    }
+
+    // the perfect index is built once, outside the timed runs
+    WeatherStation prototype;
+    int usePrototype = dictPath != NULL || percentiles;
+    if (usePrototype) {
+        initWeatherStation(&prototype, STATION_TABLE_CAPACITY);
+        if (dictPath != NULL && loadStationDictionary(&prototype, dictPath) != 0) {
+            return 1;
+        }
+        if (percentiles) {
+            enablePercentiles(&prototype);
+        }
+    }
+
+    // resolve the whole list first so a typo doesn't show up halfway through a long bench
+    const IoBackend* selected[16];
+    size_t selectedCount = 0;
+    InputFormat format = detectInputFormat(options.path);
+    options.formats = &format;
+    if (format == INPUT_COLUMNAR) {
+        // only one way to read a conv output
+        selected[selectedCount++] = &columnarBackend;
+    } else if (format == INPUT_GZIP || format == INPUT_ZSTD) {
+        // nor of a gzip or zstd file
+        selected[selectedCount++] = &compressedBackend;
+    } else if (backendList == NULL) {
+        for (size_t i = 0; i < ioBackendCount && selectedCount < 16; i++) {
+            selected[selectedCount++] = ioBackends[i];
+        }
+    } else {
+        for (char* name = strtok(backendList, ","); name != NULL && selectedCount < 16; name = strtok(NULL, ",")) {
+            selected[selectedCount] = findIoBackend(name);
+            if (selected[selectedCount] == NULL) {
+                fprintf(stderr, "unknown io backend: %s\n", name);
+                usage(argv[0]);
+                return 1;
+            }
+            selectedCount++;
+        }
+    }
+
+    FILE* csv = stdout;
+    if (csvPath != NULL) {
+        csv = fopen(csvPath, "w");
+        if (csv == NULL) {
+            perror("fopen failed");
+            return 1;
+        }
+    }
+    fprintf(csv, "backend,cache,runs,threads,median_wall_s,min_wall_s,max_wall_s,spread_pct,median_user_s,median_sys_s,median_minor_faults,median_major_faults,rows,bytes,rows_per_s,gb_per_s");
+    if (perf) {
+        // medians per row, plus ipc and cycles per byte, empty where the host has no counter
+        fprintf(csv, ",ipc,cycles_per_byte");
+        for (int e = 0; e < PERF_EVENT_COUNT; e++) fprintf(csv, ",%s_per_row", perfEventNames[e]);
+    }
+    fprintf(csv, "\n");
+
+    RunSample* samples = (RunSample*)calloc(runs, sizeof(RunSample));
+    double* values = (double*)calloc(runs, sizeof(double));
+    const char* cacheName = cold ? "cold" : "warm";
+
+    for (size_t b = 0; b < selectedCount; b++) {
+        const IoBackend* backend = selected[b];
+        uint64_t rows = 0;
+
+        // warm runs start from a populated page cache, so the first timed run is not special
+        if (!cold && runOnce(backend, &options, usePrototype ? &prototype : NULL, perf, &samples[0], &rows) != 0) {
+            return 1;
+        }
+
+        for (int r = 0; r < runs; r++) {
+            if (cold && dropFromPageCache(options.path) != 0) {
+                return 1;
+            }
+            if (runOnce(backend, &options, usePrototype ? &prototype : NULL, perf, &samples[r], &rows) != 0) {
+                return 1;
+            }
+            fprintf(stderr, "%s %s run %d/%d: %.3fs wall, %.3fs user, %.3fs sys, %.0f minor, %.0f major faults\n",
+                backend->name, cacheName, r + 1, runs, samples[r].wall, samples[r].user, samples[r].sys,
+                samples[r].minorFaults, samples[r].majorFaults);
+        }
+
+        for (int r = 0; r < runs; r++) values[r] = samples[r].wall;
+        double medianWall = median(values, runs);
+        double minWall = values[0];
+        double maxWall = values[runs - 1];
+        for (int r = 0; r < runs; r++) values[r] = samples[r].user;
+        double medianUser = median(values, runs);
+        for (int r = 0; r < runs; r++) values[r] = samples[r].sys;
+        double medianSys = median(values, runs);
+        for (int r = 0; r < runs; r++) values[r] = samples[r].minorFaults;
+        double medianMinorFaults = median(values, runs);
+        for (int r = 0; r < runs; r++) values[r] = samples[r].majorFaults;
+        double medianMajorFaults = median(values, runs);
+
+        fprintf(csv, "%s,%s,%d,%ld,%.6f,%.6f,%.6f,%.2f,%.6f,%.6f,%.0f,%.0f,%llu,%lld,%.0f,%.3f",
+            backend->name, cacheName, runs, options.threads,
+            medianWall, minWall, maxWall, 100.0 * (maxWall - minWall) / medianWall,
+            medianUser, medianSys, medianMinorFaults, medianMajorFaults,
+            (unsigned long long)rows, (long long)st.st_size,
+            rows / medianWall, st.st_size / 1e9 / medianWall);
+        if (perf) {
+            printPerfColumns(csv, samples, runs, values, (double)rows, (double)st.st_size);
+        }
+        fprintf(csv, "\n");
+        fflush(csv);
+    }
+
+    free(samples);
+    free(values);
+    if (usePrototype) {
+        freeWeatherStation(&prototype);
+    }
+    if (csv != stdout) {
+        fclose(csv);
+    }
+    return 0;
+}
@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <unistd.h> // sysconf
+#include <getopt.h> // getopt_long
+#include <glob.h> // inputs given as patterns
+#include <math.h> // NAN
+#include <sys/stat.h> // stat for the bytes per row in --perf
+#include <sys/resource.h> // struct rusage for page fault counts
+
+#include "io_backend.h"
+#include "snapshot.h"
+#include "worker_process.h"
+#include "stats.h"
+#include "weather_station.h"
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--io=", prog);
+    for (size_t i = 0; i < ioBackendCount; i++) {
+        fprintf(stderr, "%s%s", i ? "|" : "", ioBackends[i]->name);
+    }
+    fprintf(stderr, "] [--threads=N] [--queue-depth=N] [--populate] [--madvise=sequential,willneed,hugepage] [--prefault] [--chunk-size=BYTES] [--thread-stats] [--dict=stations.txt] [--snapshot=FILE] [--stats[=table|json]] [--perf] [--fork] [--percentiles] [--file-list=FILE] [measurements.txt|'pattern'...]\n");
+}
+
+// adds the files matching pattern to inputs, a plain path is kept as it is even when it
+// doesn't exist so opening it reports the error, returns 0 on success
+static int addInputs(glob_t* inputs, const char* pattern) {
+    int ret = glob(pattern, GLOB_NOCHECK | (inputs->gl_pathc > 0 ? GLOB_APPEND : 0), NULL, inputs);
+    if (ret != 0) {
+        fprintf(stderr, "glob %s failed\n", pattern);
+        return 1;
+    }
+    return 0;
+}
+
+// one path or pattern per line, for more hourly files than a command line takes
+static int addInputList(glob_t* inputs, const char* listPath) {
+    FILE* list = fopen(listPath, "r");
+    if (list == NULL) {
+        perror("fopen failed");
+        return 1;
+    }
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    int failed = 0;
+    while (!failed && (length = getline(&line, &capacity, list)) > 0) {
+        if (line[length - 1] == '\n') line[--length] = '\0';
+        if (length > 0) failed = addInputs(inputs, line);
+    }
+    free(line);
+    fclose(list);
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+
+    // clock() adds up cpu time of every thread, wall time is what we want to see drop
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    enterPhase(PHASE_SETUP);
+
+    const IoBackend* backend = &mmapBackend;
+    IoOptions options = {
+        .path = "../1brc-java/measurements.txt",
+        // default to every online core
+        .threads = sysconf(_SC_NPROCESSORS_ONLN),
+        .queueDepth = 8,
+        .chunkSize = IO_CHUNK_SIZE,
+    };
+    const char* dictPath = NULL;
+    const char* snapshotPath = NULL;
+    int statsReport = 0; // 1 for the table, 2 for JSON
+    int perfCounters = 0;
+    int forkWorker = 0;
+    int percentiles = 0;
+    glob_t inputs = { 0 };
+
+    static struct option longOptions[] = {
+        {"io", required_argument, NULL, 'i'},
+        {"threads", required_argument, NULL, 't'},
+        {"queue-depth", required_argument, NULL, 'q'},
+        {"populate", no_argument, NULL, 'P'},
+        {"madvise", required_argument, NULL, 'M'},
+        {"prefault", no_argument, NULL, 'F'},
+        {"chunk-size", required_argument, NULL, 'C'},
+        {"thread-stats", no_argument, NULL, 'S'},
+        {"dict", required_argument, NULL, 'D'},
+        {"snapshot", required_argument, NULL, 'R'},
+        {"stats", optional_argument, NULL, 's'},
+        {"perf", no_argument, NULL, 'p'},
+        {"fork", no_argument, NULL, 'f'},
+        {"percentiles", no_argument, NULL, 'Q'},
+        {"file-list", required_argument, NULL, 'L'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:t:q:", longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'i':
+            backend = findIoBackend(optarg);
+            if (backend == NULL) {
+                fprintf(stderr, "unknown io backend: %s\n", optarg);
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 't':
+            options.threads = strtol(optarg, NULL, 10);
+            break;
+        case 'q':
+            options.queueDepth = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'P':
+            options.mapPopulate = 1;
+            break;
+        case 'M':
+            if (parseMadviseHints(optarg, &options.madviseHints) != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'F':
+            options.prefault = 1;
+            break;
+        case 'C':
+            options.chunkSize = strtoull(optarg, NULL, 10);
+            break;
+        case 'S':
+            options.threadStats = 1;
+            break;
+        case 'D':
+            dictPath = optarg;
+            break;
+        case 'R':
+            snapshotPath = optarg;
+            break;
+        case 'p':
+            perfCounters = 1;
+            break;
+        case 'f':
+            forkWorker = 1;
+            break;
+        case 'Q':
+            percentiles = 1;
+            break;
+        case 'L':
+            if (addInputList(&inputs, optarg) != 0) {
+                return 1;
+            }
+            break;
+        case 's':
+            if (optarg == NULL || strcmp(optarg, "table") == 0) {
+                statsReport = 1;
+            } else if (strcmp(optarg, "json") == 0) {
+                statsReport = 2;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.threads < 1 || options.queueDepth < 1 || options.chunkSize < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    for (int i = optind; i < argc; i++) {
+        if (addInputs(&inputs, argv[i]) != 0) {
+            return 1;
+        }
+    }
+    if (inputs.gl_pathc > 0) {
+        options.path = inputs.gl_pathv[0];
+        options.paths = (const char* const*)inputs.gl_pathv;
+        options.pathCount = (int)inputs.gl_pathc;
+    }
+    if (options.pathCount > 1 && snapshotPath != NULL) {
+        fprintf(stderr, "--snapshot needs a single input\n");
+        return 1;
+    }
+    // the snapshot format, which --fork also sends the table in, has no histograms
+    if (percentiles && (snapshotPath != NULL || forkWorker)) {
+        fprintf(stderr, "--percentiles can't be combined with --snapshot or --fork\n");
+        return 1;
+    }
+    // every input is probed once, a file written by conv has no text to parse, whatever --io says
+    int probeCount = options.pathCount > 0 ? options.pathCount : 1;
+    InputFormat* formats = (InputFormat*)calloc(probeCount, sizeof(InputFormat));
+    if (formats == NULL) {
+        perror("calloc failed");
+        return 1;
+    }
+    for (int i = 0; i < probeCount; i++) {
+        formats[i] = detectInputFormat(options.pathCount > 0 ? options.paths[i] : options.path);
+    }
+    for (int i = 1; i < options.pathCount; i++) {
+        if ((formats[i] == INPUT_COLUMNAR) != (formats[0] == INPUT_COLUMNAR)) {
+            fprintf(stderr, "conv outputs and text inputs can't be mixed\n");
+            return 1;
+        }
+    }
+    if (formats[0] == INPUT_COLUMNAR) {
+        if (snapshotPath != NULL) {
+            fprintf(stderr, "--snapshot needs a text input\n");
+            return 1;
+        }
+        backend = &columnarBackend;
+    }
+    // gzip and zstd inputs are decompressed as they are parsed, plain files in the same list
+    // are streamed alongside them
+    options.formats = formats;
+    for (int i = 0; i < probeCount && backend != &columnarBackend; i++) {
+        if (formats[i] != INPUT_GZIP && formats[i] != INPUT_ZSTD) continue;
+        if (snapshotPath != NULL) {
+            fprintf(stderr, "--snapshot needs an uncompressed input\n");
+            return 1;
+        }
+        backend = &compressedBackend;
+        break;
+    }
+
+    WeatherStation ws;
+    initWeatherStation(&ws, STATION_TABLE_CAPACITY);
+    // known stations get a collision free index, rows for them skip probing
+    if (dictPath != NULL && loadStationDictionary(&ws, dictPath) != 0) {
+        freeWeatherStation(&ws);
+        return 1;
+    }
+    // after the dictionary, its stations get histograms too
+    if (percentiles) {
+        enablePercentiles(&ws);
+    }
+
+    // opened before any worker thread exists so they inherit the counters, which only run while scanning
+    if (perfCounters) {
+        openPerfCounters(statsReport == 2);
+    }
+
+    // with a snapshot only the bytes appended since it was saved are parsed, with --fork a
+    // child process does the work and this one never maps the input
+    int failed;
+    if (forkWorker) {
+        failed = runInWorkerProcess(backend, &options, &ws, snapshotPath, statsReport || perfCounters);
+    } else {
+        failed = snapshotPath != NULL ? runWithSnapshot(backend, &options, &ws, snapshotPath) : runBackend(backend, &options, &ws);
+    }
+    if (failed) {
+        freeWeatherStation(&ws);
+        return 1;
+    }
+
+    // dictionary stations with no rows are in the table but not printed
+    enterPhase(PHASE_SORT);
+    int stationCount;
+    NamedRecord* stations = sortStations(&ws, &stationCount);
+    enterPhase(PHASE_PRINT);
+    printStations(stations, stationCount);
+    free(stations);
+
+    endPhases();
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("time elapsed for %d records with %s io: %.3fs\n", stationCount, backend->name, elapsed);
+
+    // minor faults map a page that is already cached, major ones wait for the disk, the JSON
+    // report has them too and is the only thing on stderr
+    if (statsReport != 2) {
+        struct rusage usage;
+        readProcessUsage(&usage);
+        fprintf(stderr, "page faults: %ld minor, %ld major\n", usage.ru_minflt, usage.ru_majflt);
+    }
+
+    PerfReport perf;
+    if (perfCounters) {
+        readPerfCounters(perf.values);
+        closePerfCounters();
+        perf.rows = (double)countRecords(&ws);
+        // stdin has no size, per byte is left out there
+        perf.bytes = 0;
+        for (int i = 0; i < (options.pathCount > 1 ? options.pathCount : 1); i++) {
+            struct stat st;
+            const char* path = options.pathCount > 1 ? options.paths[i] : options.path;
+            perf.bytes += stat(path, &st) == 0 && S_ISREG(st.st_mode) ? (double)st.st_size : NAN;
+        }
+    }
+    if (statsReport) {
+        printStatsReport(&ws, perfCounters ? &perf : NULL, statsReport == 2);
+    } else if (perfCounters) {
+        printPerfReport(&perf);
+    }
+
+    freeWeatherStation(&ws);
+    globfree(&inputs);
+    free(formats);
+    return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <stdint.h>
+
+// binary columnar form of measurements.txt written once by conv, every later query maps it and
+// skips the newline scan and the number parse, 4 bytes per row instead of about 14
+//
+// [header][pad to dataOffset][block 0][block 1]...[dictionary]
+// block i starts at dataOffset + i * blockRows * 4 and holds n rows, blockRows for every block
+// but the last: uint16 station ids[n] then int16 temperatures[n] (tenths of a degree)
+// the dictionary is stationCount entries of (uint8 length, name bytes) in station id order
+// conv sorts the rows of each block by station id, so a block is a run per station and the
+// aggregator reduces each run with a plain loop over the temperatures the compiler vectorizes,
+// any row order is still aggregated correctly
+
+#define COLUMNAR_MAGIC "BRCCOL01"
+#define COLUMNAR_DATA_OFFSET 4096 // blocks start page aligned
+#define COLUMNAR_BLOCK_ROWS (64 * 1024)
+#define COLUMNAR_MAX_STATIONS 65536 // ids are uint16
+
+typedef struct ColumnarHeader {
+    char magic[8];
+    uint32_t blockRows;
+    uint32_t stationCount;
+    uint64_t rowCount;
+    uint64_t dataOffset;
+    uint64_t dictionaryOffset;
+} ColumnarHeader;
+
+#endif
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <fcntl.h> // open
+#include <unistd.h> // read, write, pwrite
+#include <getopt.h> // getopt_long
+
+#include "columnar.h"
+#include "io_backend.h"
+#include "parse.h"
+
+// one time converter from measurements.txt to the columnar format in columnar.h, the rows
+// are parsed once here so repeated queries on the output never parse text again
+
+typedef struct ConvStation {
+    const char* name; // in the ids table's arena
+    uint32_t length;
+} ConvStation;
+
+typedef struct Converter {
+    int fd;
+    WeatherStation ids; // name -> station id, the table is only used as a map and the id rides in numRecords
+    ConvStation* stations;
+    uint32_t stationCount;
+    uint32_t blockRows;
+    uint32_t blockFill;
+    uint16_t* blockIds;
+    int16_t* blockTemps;
+    uint16_t* sortedIds;
+    int16_t* sortedTemps;
+    uint32_t* idStarts; // counting sort offsets, one per station id
+    uint64_t rowCount;
+    uint64_t blockCount;
+} Converter;
+
+static int writeAll(int fd, const void* data, size_t length) {
+    const char* p = (const char*)data;
+    while (length > 0) {
+        ssize_t written = write(fd, p, length);
+        if (written < 0) {
+            perror("write failed");
+            return 1;
+        }
+        p += written;
+        length -= written;
+    }
+    return 0;
+}
+
+// ids are handed out in first seen order
+static int stationId(Converter* conv, const char* name, uint32_t length) {
+    uint32_t hash = hashName(name, length);
+    StationSlot* slot = findStation(&conv->ids, name, hash, length);
+    if (slot->length != 0) {
+        return (int)slot->record.numRecords;
+    }
+    // the dictionary stores each name's length in one byte
+    if (length > UINT8_MAX) {
+        fprintf(stderr, "station name of %u bytes, the columnar dictionary takes at most %d\n", length, UINT8_MAX);
+        return -1;
+    }
+    if (conv->stationCount == COLUMNAR_MAX_STATIONS) {
+        fprintf(stderr, "more than %d stations, ids are 16 bit\n", COLUMNAR_MAX_STATIONS);
+        return -1;
+    }
+    slot = insertStation(&conv->ids, name, length, hash);
+    slot->record.numRecords = conv->stationCount;
+    conv->stations[conv->stationCount].name = slot->name;
+    conv->stations[conv->stationCount].length = length;
+    return (int)conv->stationCount++;
+}
+
+// counting sort of the block by station id, then both columns go out back to back
+static int flushBlock(Converter* conv) {
+    uint32_t rows = conv->blockFill;
+    if (rows == 0) return 0;
+
+    memset(conv->idStarts, 0, conv->stationCount * sizeof(uint32_t));
+    for (uint32_t i = 0; i < rows; i++) conv->idStarts[conv->blockIds[i]]++;
+    uint32_t offset = 0;
+    for (uint32_t id = 0; id < conv->stationCount; id++) {
+        uint32_t count = conv->idStarts[id];
+        conv->idStarts[id] = offset;
+        offset += count;
+    }
+    for (uint32_t i = 0; i < rows; i++) {
+        uint32_t to = conv->idStarts[conv->blockIds[i]]++;
+        conv->sortedIds[to] = conv->blockIds[i];
+        conv->sortedTemps[to] = conv->blockTemps[i];
+    }
+
+    conv->blockFill = 0;
+    conv->blockCount++;
+    return writeAll(conv->fd, conv->sortedIds, rows * sizeof(uint16_t)) ||
+           writeAll(conv->fd, conv->sortedTemps, rows * sizeof(int16_t));
+}
+
+// same row loop as processRows, the rows go into the block columns instead of the table
+static int convertRows(Converter* conv, const char* p, const char* end) {
+    while (p < end) {
+        uint32_t nameLength;
+        int temp;
+        const char* next = parseRow(p, end, &nameLength, &temp);
+        if (next == NULL) break;
+
+        int id = stationId(conv, p, nameLength);
+        if (id < 0) return 1;
+        conv->blockIds[conv->blockFill] = (uint16_t)id;
+        conv->blockTemps[conv->blockFill] = (int16_t)temp;
+        conv->rowCount++;
+        if (++conv->blockFill == conv->blockRows && flushBlock(conv) != 0) return 1;
+        p = next;
+    }
+    return 0;
+}
+
+static int convertInput(Converter* conv, int in) {
+    char* buffer = (char*)malloc(IO_BUFFER_SIZE);
+    if (buffer == NULL) {
+        perror("malloc failed");
+        return 1;
+    }
+
+    // a row cut by the end of one read is carried to the front and completed by the next
+    size_t carry = 0;
+    ssize_t bytesRead;
+    int failed = 0;
+    while (!failed && (bytesRead = read(in, buffer + carry, IO_BUFFER_SIZE - carry)) > 0) {
+        size_t length = carry + bytesRead;
+        const char* rowsEnd = lastRowEnd(buffer, buffer + length);
+        failed = convertRows(conv, buffer, rowsEnd);
+        carry = buffer + length - rowsEnd;
+        memmove(buffer, rowsEnd, carry);
+    }
+    if (!failed && bytesRead < 0) {
+        perror("read failed");
+        failed = 1;
+    }
+
+    // the last row may have no trailing newline
+    if (!failed) {
+        failed = convertRows(conv, buffer, buffer + carry) || flushBlock(conv);
+    }
+    free(buffer);
+    return failed;
+}
+
+static int writeDictionary(Converter* conv) {
+    for (uint32_t id = 0; id < conv->stationCount; id++) {
+        uint8_t length = (uint8_t)conv->stations[id].length;
+        if (writeAll(conv->fd, &length, 1) || writeAll(conv->fd, conv->stations[id].name, length)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--block-rows=N] <measurements.txt> <output>\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    Converter conv;
+    memset(&conv, 0, sizeof(conv));
+    conv.blockRows = COLUMNAR_BLOCK_ROWS;
+
+    static struct option longOptions[] = {
+        {"block-rows", required_argument, NULL, 'b'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:", longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'b':
+            conv.blockRows = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 2 || conv.blockRows < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int in = open(argv[optind], O_RDONLY);
+    if (in < 0) {
+        perror("open failed");
+        return 1;
+    }
+    conv.fd = open(argv[optind + 1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (conv.fd < 0) {
+        perror("open failed");
+        close(in);
+        return 1;
+    }
+
+    initWeatherStation(&conv.ids, STATION_TABLE_CAPACITY);
+    conv.stations = (ConvStation*)calloc(COLUMNAR_MAX_STATIONS, sizeof(ConvStation));
+    conv.idStarts = (uint32_t*)calloc(COLUMNAR_MAX_STATIONS, sizeof(uint32_t));
+    conv.blockIds = (uint16_t*)malloc(conv.blockRows * sizeof(uint16_t));
+    conv.blockTemps = (int16_t*)malloc(conv.blockRows * sizeof(int16_t));
+    conv.sortedIds = (uint16_t*)malloc(conv.blockRows * sizeof(uint16_t));
+    conv.sortedTemps = (int16_t*)malloc(conv.blockRows * sizeof(int16_t));
+    if (conv.stations == NULL || conv.idStarts == NULL || conv.blockIds == NULL || conv.blockTemps == NULL ||
+        conv.sortedIds == NULL || conv.sortedTemps == NULL) {
+        perror("malloc failed");
+        return 1;
+    }
+
+    // blocks first, the dictionary is only complete once the input has been read and goes
+    // after them, the header that points at both is written last
+    int failed = lseek(conv.fd, COLUMNAR_DATA_OFFSET, SEEK_SET) < 0 || convertInput(&conv, in);
+    ColumnarHeader header;
+    memset(&header, 0, sizeof(header));
+    if (!failed) {
+        memcpy(header.magic, COLUMNAR_MAGIC, sizeof(header.magic));
+        header.blockRows = conv.blockRows;
+        header.stationCount = conv.stationCount;
+        header.rowCount = conv.rowCount;
+        header.dataOffset = COLUMNAR_DATA_OFFSET;
+        header.dictionaryOffset = COLUMNAR_DATA_OFFSET + conv.rowCount * (sizeof(uint16_t) + sizeof(int16_t));
+        failed = writeDictionary(&conv) || pwrite(conv.fd, &header, sizeof(header), 0) != sizeof(header);
+    }
+    if (close(conv.fd) != 0) failed = 1;
+    close(in);
+
+    if (failed) {
+        // no half written file that brc would take for text
+        unlink(argv[optind + 1]);
+        fprintf(stderr, "conversion failed\n");
+    } else {
+        fprintf(stderr, "%llu rows, %u stations, %llu blocks of %u rows\n", (unsigned long long)conv.rowCount,
+            conv.stationCount, (unsigned long long)conv.blockCount, conv.blockRows);
+    }
+
+    freeWeatherStation(&conv.ids);
+    free(conv.stations);
+    free(conv.idStarts);
+    free(conv.blockIds);
+    free(conv.blockTemps);
+    free(conv.sortedIds);
+    free(conv.sortedTemps);
+    return failed;
+}
@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h> // pow for the zipf weights
+
+#include <fcntl.h> // open
+#include <unistd.h> // write, sysconf
+#include <getopt.h> // getopt_long
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "weather_station.h"
+
+// native 1BRC measurements generator, the output only depends on the seed and the shape
+// options, never on the thread count, so every backend can be benched on the same bytes
+
+// rows per block, each block has its own rng stream and blocks are written in order
+#define BLOCK_ROWS (64 * 1024)
+// longest row: 100 byte name + ';' + "-99.9" + '\n'
+#define MAX_ROW_BYTES 107
+
+typedef enum { NAMES_SHORT, NAMES_MIXED, NAMES_LONG } NameShape;
+typedef enum { KEYS_UNIFORM, KEYS_ZIPF } KeyShape;
+
+typedef struct GenStation {
+    char name[101];
+    int length;
+    int meanTemp; // tenths of a degree
+} GenStation;
+
+typedef struct Generator {
+    GenStation* stations;
+    int stationCount;
+    double* zipfCdf; // NULL for uniform keys
+    KeyShape keys;
+    uint64_t seed;
+    uint64_t rows;
+    uint64_t blockCount;
+
+    int fd;
+    atomic_uint_fast64_t nextBlock; // next block to generate
+    uint64_t nextWrite; // next block allowed to write, guarded by lock
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+    int failed;
+} Generator;
+
+// splitmix64, tiny and good enough for test data, every stream is derived from the seed
+static uint64_t nextRandom(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t randomBelow(uint64_t* state, uint64_t bound) {
+    return nextRandom(state) % bound;
+}
+
+static double randomUnit(uint64_t* state) {
+    return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// a mix of ascii and 2 and 3 byte utf-8 sequences, none of them contain ';' or '\n'
+static const char* const utf8Pieces[] = { "\xc3\xa9", "\xc3\xbc", "\xc3\xb8", "\xc3\xb1", "\xc3\xa7", "\xc5\x82", "\xe4\xba\xac", "\xe6\x9d\xb1", "\xe0\xa4\x95" };
+#define UTF8_PIECE_COUNT (sizeof(utf8Pieces) / sizeof(utf8Pieces[0]))
+
+// builds a name of exactly target bytes (never splitting a utf-8 sequence), utf8 mixes in
+// multi byte characters, otherwise it is letters with the odd space like real station names
+static int makeName(uint64_t* state, char* name, int target, int utf8) {
+    int length = 0;
+    name[length++] = 'A' + randomBelow(state, 26);
+    while (length < target) {
+        int left = target - length;
+        uint64_t pick = randomBelow(state, 16);
+        if (utf8 && pick < 4) {
+            const char* piece = utf8Pieces[randomBelow(state, UTF8_PIECE_COUNT)];
+            int pieceLength = (int)strlen(piece);
+            if (pieceLength <= left) {
+                memcpy(name + length, piece, pieceLength);
+                length += pieceLength;
+                continue;
+            }
+        }
+        // no leading, trailing or double spaces
+        if (pick == 15 && left > 1 && name[length - 1] != ' ') {
+            name[length++] = ' ';
+        } else {
+            name[length++] = 'a' + randomBelow(state, 26);
+        }
+    }
+    name[length] = '\0';
+    return length;
+}
+
+static int makeStations(Generator* gen, NameShape shape) {
+    uint64_t state = gen->seed;
+    gen->stations = (GenStation*)calloc(gen->stationCount, sizeof(GenStation));
+    if (gen->stations == NULL) {
+        perror("calloc failed");
+        return 1;
+    }
+
+    // the station table doubles as the uniqueness check for generated names
+    WeatherStation seen;
+    initWeatherStation(&seen, gen->stationCount * 2);
+
+    for (int i = 0; i < gen->stationCount; i++) {
+        GenStation* station = &gen->stations[i];
+        int attempts = 0;
+        do {
+            if (++attempts > 1000) {
+                fprintf(stderr, "could not find %d unique names of this shape\n", gen->stationCount);
+                freeWeatherStation(&seen);
+                return 1;
+            }
+            int target;
+            switch (shape) {
+            case NAMES_SHORT: target = 3 + (int)randomBelow(&state, 14); break;
+            case NAMES_MIXED: target = 1 + (int)randomBelow(&state, 100); break;
+            default: target = 100; break;
+            }
+            station->length = makeName(&state, station->name, target, shape != NAMES_SHORT);
+        } while (findStation(&seen, station->name, hashName(station->name, station->length), station->length)->length != 0);
+
+        insertStation(&seen, station->name, station->length, hashName(station->name, station->length));
+        station->meanTemp = -300 + (int)randomBelow(&state, 701);
+    }
+
+    freeWeatherStation(&seen);
+    return 0;
+}
+
+// cumulative zipf weights 1/rank^s, rows pick a station by binary search on a uniform draw
+static int makeZipf(Generator* gen, double exponent) {
+    gen->zipfCdf = (double*)malloc(gen->stationCount * sizeof(double));
+    if (gen->zipfCdf == NULL) {
+        perror("malloc failed");
+        return 1;
+    }
+    double total = 0;
+    for (int i = 0; i < gen->stationCount; i++) {
+        total += 1.0 / pow(i + 1, exponent);
+        gen->zipfCdf[i] = total;
+    }
+    for (int i = 0; i < gen->stationCount; i++) {
+        gen->zipfCdf[i] /= total;
+    }
+    return 0;
+}
+
+static int pickStation(const Generator* gen, uint64_t* state) {
+    if (gen->keys == KEYS_UNIFORM) {
+        return (int)randomBelow(state, gen->stationCount);
+    }
+    double u = randomUnit(state);
+    int low = 0, high = gen->stationCount - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (gen->zipfCdf[mid] < u) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static size_t generateBlock(const Generator* gen, uint64_t block, char* out) {
+    // each block gets its own stream, so block contents don't depend on which thread made them
+    uint64_t state = gen->seed ^ (block * 0xd1b54a32d192ed03ULL);
+    nextRandom(&state);
+
+    uint64_t first = block * BLOCK_ROWS;
+    uint64_t count = gen->rows - first < BLOCK_ROWS ? gen->rows - first : BLOCK_ROWS;
+
+    char* p = out;
+    for (uint64_t r = 0; r < count; r++) {
+        const GenStation* station = &gen->stations[pickStation(gen, &state)];
+
+        // sum of 4 uniforms is close enough to a bell curve around the station mean
+        int spread = 0;
+        for (int k = 0; k < 4; k++) spread += (int)randomBelow(&state, 201) - 100;
+        int temp = station->meanTemp + spread;
+        if (temp > 999) temp = 999;
+        if (temp < -999) temp = -999;
+
+        memcpy(p, station->name, station->length);
+        p += station->length;
+        *p++ = ';';
+        if (temp < 0) {
+            *p++ = '-';
+            temp = -temp;
+        }
+        if (temp >= 100) *p++ = '0' + temp / 100;
+        *p++ = '0' + (temp / 10) % 10;
+        *p++ = '.';
+        *p++ = '0' + temp % 10;
+        *p++ = '\n';
+    }
+    return p - out;
+}
+
+static int writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            perror("write failed");
+            return 1;
+        }
+        data += written;
+        length -= written;
+    }
+    return 0;
+}
+
+static void* generatorThread(void* arg) {
+    Generator* gen = (Generator*)arg;
+    char* buffer = (char*)malloc((size_t)BLOCK_ROWS * MAX_ROW_BYTES);
+    if (buffer == NULL) {
+        perror("malloc failed");
+        pthread_mutex_lock(&gen->lock);
+        gen->failed = 1;
+        pthread_cond_broadcast(&gen->turn);
+        pthread_mutex_unlock(&gen->lock);
+        return NULL;
+    }
+
+    uint64_t block;
+    while ((block = atomic_fetch_add(&gen->nextBlock, 1)) < gen->blockCount) {
+        size_t length = generateBlock(gen, block, buffer);
+
+        // generation runs in parallel, writes happen strictly in block order
+        pthread_mutex_lock(&gen->lock);
+        while (gen->nextWrite != block && !gen->failed) {
+            pthread_cond_wait(&gen->turn, &gen->lock);
+        }
+        if (gen->failed) {
+            pthread_mutex_unlock(&gen->lock);
+            break;
+        }
+        pthread_mutex_unlock(&gen->lock);
+
+        int failed = writeAll(gen->fd, buffer, length);
+
+        pthread_mutex_lock(&gen->lock);
+        gen->failed |= failed;
+        gen->nextWrite++;
+        pthread_cond_broadcast(&gen->turn);
+        pthread_mutex_unlock(&gen->lock);
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s --rows=N [--stations=413] [--names=short|mixed|long] [--keys=uniform|zipf] [--zipf-s=1.0] [--seed=N] [--threads=N] <output>\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    Generator gen;
+    memset(&gen, 0, sizeof(gen));
+    gen.stationCount = 413;
+    gen.seed = 1;
+    gen.keys = KEYS_UNIFORM;
+    NameShape names = NAMES_SHORT;
+    double zipfExponent = 1.0;
+    long threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+    int haveRows = 0;
+
+    static struct option longOptions[] = {
+        {"rows", required_argument, NULL, 'r'},
+        {"stations", required_argument, NULL, 's'},
+        {"names", required_argument, NULL, 'n'},
+        {"keys", required_argument, NULL, 'k'},
+        {"zipf-s", required_argument, NULL, 'z'},
+        {"seed", required_argument, NULL, 'e'},
+        {"threads", required_argument, NULL, 't'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:s:n:k:z:e:t:", longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'r':
+            gen.rows = strtoull(optarg, NULL, 10);
+            haveRows = 1;
+            break;
+        case 's':
+            gen.stationCount = (int)strtol(optarg, NULL, 10);
+            break;
+        case 'n':
+            if (strcmp(optarg, "short") == 0) names = NAMES_SHORT;
+            else if (strcmp(optarg, "mixed") == 0) names = NAMES_MIXED;
+            else if (strcmp(optarg, "long") == 0) names = NAMES_LONG;
+            else { usage(argv[0]); return 1; }
+            break;
+        case 'k':
+            if (strcmp(optarg, "uniform") == 0) gen.keys = KEYS_UNIFORM;
+            else if (strcmp(optarg, "zipf") == 0) gen.keys = KEYS_ZIPF;
+            else { usage(argv[0]); return 1; }
+            break;
+        case 'z':
+            zipfExponent = strtod(optarg, NULL);
+            break;
+        case 'e':
+            gen.seed = strtoull(optarg, NULL, 10);
+            break;
+        case 't':
+            threadCount = strtol(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!haveRows || optind != argc - 1 || gen.stationCount < 1 || threadCount < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (makeStations(&gen, names) != 0) return 1;
+    if (gen.keys == KEYS_ZIPF && makeZipf(&gen, zipfExponent) != 0) return 1;
+
+    gen.fd = open(argv[optind], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (gen.fd < 0) {
+        perror("open failed");
+        return 1;
+    }
+
+    gen.blockCount = (gen.rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    atomic_init(&gen.nextBlock, 0);
+    pthread_mutex_init(&gen.lock, NULL);
+    pthread_cond_init(&gen.turn, NULL);
+
+    pthread_t* threads = (pthread_t*)calloc(threadCount, sizeof(pthread_t));
+    long started = 0;
+    for (long t = 0; t < threadCount; t++) {
+        if (pthread_create(&threads[t], NULL, generatorThread, &gen) != 0) {
+            perror("pthread_create");
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        gen.failed = 1;
+    }
+    for (long t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    free(threads);
+    free(gen.stations);
+    free(gen.zipfCdf);
+    if (close(gen.fd) < 0) {
+        perror("close failed");
+        gen.failed = 1;
+    }
+    return gen.failed;
+}
@@ -10,15 +10,24 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <getopt.h>
+#include <time.h>
 
 #include <linux/io_uring.h>
 
-#define QUEUE_DEPTH 1
-#define BLOCK_SZ    1024
+// cat on a hand built io_uring, without liburing, as a reader that can be reused:
+// - the buffer pool and every input fd are registered once, so a read doesn't have to pin
+//   its pages or look its file up again (IORING_OP_READ_FIXED + IOSQE_FIXED_FILE)
+// - reads are queued in batches, every free buffer gets a read before the tail is published,
+//   and completions are reaped in batches, one io_uring_enter submits the batch and waits
+// - with -q the kernel polls the submission ring from its own thread (SQPOLL), publishing the
+//   tail is the submission and io_uring_enter is only needed to wait or wake that thread up
+// blocks of every file are read in turn, up to the queue depth at once, and written to stdout
+// in order as they complete
 
-/* This is x86 specific */
-#define read_barrier()  __asm__ __volatile__("":::"memory")
-#define write_barrier() __asm__ __volatile__("":::"memory")
+#define QUEUE_DEPTH      64
+#define BLOCK_SZ         (128 * 1024)
+#define SQ_THREAD_IDLE   2000 // ms the SQPOLL thread spins without work before it sleeps
 
 struct app_io_sq_ring
 {
@@ -39,18 +48,47 @@ struct app_io_cq_ring
     struct io_uring_cqe *cqes; // directly managing its cqe
 };
 
-struct submitter
+// one buffer of the registered pool and the block read into it, the slot index is both the
+// buf_index of the fixed read and the user_data of its completion
+struct read_slot
+{
+    char *buf;
+    unsigned file;          // index in the registered file table
+    off_t offset;
+    unsigned len;           // bytes of the block
+    unsigned filled;        // bytes read so far, a short read is resubmitted for the rest
+    int done;
+    unsigned long long seq; // position in the output order
+};
+
+struct uring_reader
 {
     int ring_fd;
+    int sqpoll;
+    unsigned depth;
+    unsigned block_sz;
     struct app_io_sq_ring sq_ring;
     struct io_uring_sqe *sqes;
     struct app_io_cq_ring cq_ring;
-};
-
-struct file_info
-{
-    off_t file_size;
-    struct iovec iovecs[]; // flexible array member, no fixed size
+    unsigned sq_tail; // local tail, published once per batch
+
+    char *pool;
+    struct read_slot *slots;
+    unsigned *free_slots;
+    unsigned free_count;
+    unsigned *order; // slot of every seq in flight, at seq % depth
+    unsigned in_flight;
+
+    int *fds;
+    off_t *sizes;
+    unsigned file_count;
+    unsigned next_file; // the next block to queue
+    off_t next_offset;
+    unsigned long long next_seq;
+    unsigned long long out_seq; // the next block to write
+
+    unsigned long long enters; // io_uring_enter calls
+    unsigned long long bytes;
 };
 
 // system call wrappers for io_uring
@@ -64,6 +102,11 @@ int io_uring_enter(int ring_fd, unsigned int to_submit, unsigned int min_complet
     return (int) syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
 }
 
+int io_uring_register(int ring_fd, unsigned int opcode, void *arg, unsigned int nr_args)
+{
+    return (int) syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
 off_t get_file_size(int fd)
 {
     struct stat st;
@@ -91,24 +134,21 @@ off_t get_file_size(int fd)
     return -1;
 }
 
-void output_to_console(char* buf, int len)
-{
-    while(len--)
-    {
-        fputc(*buf++, stdout);
-    }
-}
-
-int app_setup_uring(struct submitter *s)
+int app_setup_uring(struct uring_reader *r)
 {
-    struct app_io_sq_ring *sring = &s->sq_ring;
-    struct app_io_cq_ring *cring = &s->cq_ring;
+    struct app_io_sq_ring *sring = &r->sq_ring;
+    struct app_io_cq_ring *cring = &r->cq_ring;
     struct io_uring_params p;
     void *sq_ptr, *cq_ptr;
 
     memset(&p, 0, sizeof(p));
-    s->ring_fd = io_uring_setup(QUEUE_DEPTH, &p);
-    if (s->ring_fd < 0)
+    if (r->sqpoll)
+    {
+        p.flags = IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = SQ_THREAD_IDLE;
+    }
+    r->ring_fd = io_uring_setup(r->depth, &p);
+    if (r->ring_fd < 0)
     {
         perror("io_uring_setup");
         return 1;
@@ -116,11 +156,11 @@ int app_setup_uring(struct submitter *s)
 
     // io-uring comms happens via 2 shared kernel-user space ring buffers
     // which can be jointly mapped with a single mmap call.
-    // completion queue is directly manipulated, the 
+    // completion queue is directly manipulated, the
     // submission queue has an indirection in between
 
     int sring_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
-    int cring_sz = p.cq_off.cqes + p.cq_entries + sizeof(struct io_uring_cqe);
+    int cring_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
 
     if (p.features & IORING_FEAT_SINGLE_MMAP)
     {
@@ -131,7 +171,7 @@ int app_setup_uring(struct submitter *s)
     }
 
     // map in the submission queue + completion queue ring buffers
-    sq_ptr = mmap(0, sring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s->ring_fd, IORING_OFF_SQ_RING);
+    sq_ptr = mmap(0, sring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQ_RING);
     if (sq_ptr == MAP_FAILED)
     {
         perror("mmap");
@@ -145,7 +185,7 @@ int app_setup_uring(struct submitter *s)
     else
     {
         // map in completion queue ring buffer in older kernels separately
-        cq_ptr = mmap(0, cring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s->ring_fd, IORING_OFF_CQ_RING);
+        cq_ptr = mmap(0, cring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_CQ_RING);
         if (cq_ptr == MAP_FAILED)
         {
             perror("mmap");
@@ -162,168 +202,336 @@ int app_setup_uring(struct submitter *s)
     sring->array = sq_ptr + p.sq_off.array;
 
     // Map in the submission queue entries
-    s->sqes = mmap(0, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s->ring_fd, IORING_OFF_SQES);
-    if (s->sqes == MAP_FAILED)
+    r->sqes = mmap(0, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED)
     {
         perror("mmap");
         return 1;
     }
 
-    // save useful fields in global struct for later easy reference
     cring->head = cq_ptr + p.cq_off.head;
     cring->tail = cq_ptr + p.cq_off.tail;
     cring->ring_mask = cq_ptr + p.cq_off.ring_mask;
     cring->ring_entries = cq_ptr + p.cq_off.ring_entries;
     cring->cqes = cq_ptr + p.cq_off.cqes;
 
+    r->sq_tail = *sring->tail;
     return 0;
 }
 
-int read_from_cq(struct submitter *s)
+// one aligned allocation cut into depth blocks, registered so the kernel pins it once for
+// the whole run instead of once per read
+int register_buffers(struct uring_reader *r)
 {
-    struct file_info *fi;
-    struct app_io_cq_ring *cring = &s->cq_ring;
-    struct io_uring_cqe *cqe;
-    unsigned head, reaped = 0;
+    void *pool;
+    // heap memory like malloc but aligned as per user, used with direct IO eg: 4KB page size alignment
+    if (posix_memalign(&pool, 4096, (size_t) r->depth * r->block_sz))
+    {
+        perror("posix_memalign");
+        return 1;
+    }
+    r->pool = pool;
 
-    head = *cring->head;
+    struct iovec *iovecs = calloc(r->depth, sizeof(struct iovec));
+    r->slots = calloc(r->depth, sizeof(struct read_slot));
+    r->free_slots = calloc(r->depth, sizeof(unsigned));
+    r->order = calloc(r->depth, sizeof(unsigned));
+    if (!iovecs || !r->slots || !r->free_slots || !r->order)
+    {
+        perror("calloc");
+        return 1;
+    }
+    for (unsigned i = 0; i < r->depth; i++)
+    {
+        r->slots[i].buf = r->pool + (size_t) i * r->block_sz;
+        iovecs[i].iov_base = r->slots[i].buf;
+        iovecs[i].iov_len = r->block_sz;
+        r->free_slots[i] = r->depth - 1 - i;
+    }
+    r->free_count = r->depth;
 
-    do
+    int ret = io_uring_register(r->ring_fd, IORING_REGISTER_BUFFERS, iovecs, r->depth);
+    free(iovecs);
+    if (ret < 0)
     {
-        read_barrier();
+        perror("io_uring_register buffers");
+        return 1;
+    }
+    return 0;
+}
 
-        // if head = tail in a ring buffer, it means buffer is empty
-        if (head == *cring->tail) break;
+// opens every input up front and registers the fds, a fixed file read indexes this table
+int register_files(struct uring_reader *r, char **paths, unsigned count)
+{
+    r->fds = calloc(count, sizeof(int));
+    r->sizes = calloc(count, sizeof(off_t));
+    if (!r->fds || !r->sizes)
+    {
+        perror("calloc");
+        return 1;
+    }
+    r->file_count = count;
+    for (unsigned i = 0; i < count; i++)
+    {
+        r->fds[i] = open(paths[i], O_RDONLY);
+        if (r->fds[i] < 0)
+        {
+            perror(paths[i]);
+            return 1;
+        }
+        r->sizes[i] = get_file_size(r->fds[i]);
+        if (r->sizes[i] < 0)
+        {
+            return 1;
+        }
+    }
 
-        cqe = &cring->cqes[head & *s->cq_ring.ring_mask];
-        fi = (struct file_info*)cqe->user_data;
-        if (cqe->res < 0) fprintf(stderr, "Error: %s\n", strerror(abs(cqe->res)));
+    if (io_uring_register(r->ring_fd, IORING_REGISTER_FILES, r->fds, count) < 0)
+    {
+        perror("io_uring_register files");
+        return 1;
+    }
+    return 0;
+}
 
-        int blocks = (int) fi->file_size / BLOCK_SZ;
-        if (fi->file_size % BLOCK_SZ) blocks++;
+// writes the sqe for the rest of the slot's block, it becomes visible with the next publish
+void prep_read(struct uring_reader *r, unsigned slot_index)
+{
+    struct read_slot *slot = &r->slots[slot_index];
+    unsigned index = r->sq_tail & *r->sq_ring.ring_mask;
+    struct io_uring_sqe *sqe = &r->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->fd = slot->file;
+    sqe->addr = (unsigned long) (slot->buf + slot->filled);
+    sqe->len = slot->len - slot->filled;
+    sqe->off = slot->offset + slot->filled;
+    sqe->buf_index = slot_index;
+    sqe->user_data = slot_index;
+    r->sq_ring.array[index] = index;
+    r->sq_tail++;
+    r->in_flight++;
+}
 
-        for (int i = 0; i < blocks; i++)
+// a read for every free buffer, in file order
+void queue_reads(struct uring_reader *r)
+{
+    while (r->free_count > 0)
+    {
+        while (r->next_file < r->file_count && r->next_offset >= r->sizes[r->next_file])
         {
-            output_to_console(fi->iovecs[i].iov_base, fi->iovecs[i].iov_len);
+            r->next_file++;
+            r->next_offset = 0;
         }
-        head++;
-    } while(1);
+        if (r->next_file == r->file_count) break;
+
+        unsigned slot_index = r->free_slots[--r->free_count];
+        struct read_slot *slot = &r->slots[slot_index];
+        off_t left = r->sizes[r->next_file] - r->next_offset;
+        slot->file = r->next_file;
+        slot->offset = r->next_offset;
+        slot->len = left < r->block_sz ? (unsigned) left : r->block_sz;
+        slot->filled = 0;
+        slot->done = 0;
+        slot->seq = r->next_seq++;
+        r->order[slot->seq % r->depth] = slot_index;
+        r->next_offset += slot->len;
+        prep_read(r, slot_index);
+    }
+}
 
-    *cring->head = head;
-    write_barrier();
+// makes the sqes written since the last call visible to the kernel, returns how many
+unsigned publish(struct uring_reader *r)
+{
+    unsigned to_submit = r->sq_tail - *r->sq_ring.tail;
+    // the sqes must be written before the kernel (or its SQPOLL thread) sees the new tail
+    __atomic_store_n(r->sq_ring.tail, r->sq_tail, __ATOMIC_RELEASE);
+    return to_submit;
 }
 
-int submit_to_sq(char* file_path, struct submitter* s)
+// submits what was queued and waits until at least wait_for reads completed, with SQPOLL
+// only when there is nothing to reap yet or the poll thread went to sleep
+int submit_and_wait(struct uring_reader *r, unsigned wait_for)
 {
-    struct file_info *fi;
-    int file_fd = open(file_path, O_RDONLY);
-    if (file_fd < 0)
+    unsigned to_submit = publish(r);
+    unsigned flags = 0;
+    if (r->sqpoll)
     {
-        perror("open");
-        return 1;
+        to_submit = 0;
+        // the poll thread sleeps after SQ_THREAD_IDLE ms without work, a release store and an
+        // acquire load can still be reordered (store then load), so without a full barrier we
+        // could read flags from before the thread went to sleep while it misses the new tail,
+        // never wake it and wait forever (liburing's io_uring_smp_mb)
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(r->sq_ring.flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+        {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+        unsigned ready = __atomic_load_n(r->cq_ring.tail, __ATOMIC_ACQUIRE) - *r->cq_ring.head;
+        if (ready >= wait_for) wait_for = 0;
+        if (wait_for == 0 && flags == 0) return 0;
     }
+    if (wait_for > 0)
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+    if (to_submit == 0 && flags == 0) return 0;
 
-    struct app_io_sq_ring *sring = &s->sq_ring;
-    unsigned index = 0, current_block = 0, tail = 0, next_tail = 0;
-
-    off_t file_sz = get_file_size(file_fd);
-    off_t bytes_remaining = file_sz;
-    int blocks = (int) file_sz / BLOCK_SZ;
-    if (file_sz % BLOCK_SZ) blocks++;
-
-    fi = malloc(sizeof(*fi) + sizeof(struct iovec) * blocks);
-    if (!fi)
+    r->enters++;
+    if (io_uring_enter(r->ring_fd, to_submit, wait_for, flags) < 0)
     {
-        fprintf(stderr, "Unable to allocate memory\n");
+        perror("io_uring_enter");
         return 1;
     }
-    fi->file_size = file_sz;
+    return 0;
+}
 
-    while (bytes_remaining)
-    {
-        off_t bytes_to_read = bytes_remaining;
-        if (bytes_to_read > BLOCK_SZ) bytes_to_read = BLOCK_SZ;
+// takes every completion there is, a short read goes straight back on the ring for the rest
+int reap_completions(struct uring_reader *r)
+{
+    struct app_io_cq_ring *cring = &r->cq_ring;
+    unsigned head = *cring->head;
+    unsigned tail = __atomic_load_n(cring->tail, __ATOMIC_ACQUIRE);
 
-        void *buf;
-        // heap memory like malloc but aligned as per user, used with direct IO eg: 4KB page size alignment
-        if (posix_memalign(&buf, BLOCK_SZ, BLOCK_SZ))
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe *cqe = &cring->cqes[head & *cring->ring_mask];
+        unsigned slot_index = (unsigned) cqe->user_data;
+        struct read_slot *slot = &r->slots[slot_index];
+        r->in_flight--;
+        if (cqe->res < 0)
         {
-            perror("posix_memalign");
+            fprintf(stderr, "Error: %s\n", strerror(-cqe->res));
             return 1;
         }
-        fi->iovecs[current_block].iov_base = buf;
-        fi->iovecs[current_block].iov_len = bytes_to_read;
-        current_block++;
-        bytes_remaining-=bytes_to_read;
+
+        slot->filled += cqe->res;
+        // 0 bytes before the end of the block means the file shrank, write what there is
+        if (cqe->res > 0 && slot->filled < slot->len)
+        {
+            prep_read(r, slot_index);
+        }
+        else
+        {
+            slot->done = 1;
+        }
     }
 
-    // Add our submission queue entry to the tail of the SQL ring buffer
-    next_tail = tail = *sring->tail;
-    next_tail++;
-    read_barrier(); // to prevent compiler from ordering read/write memory across this boundary
-    index = tail & *s->sq_ring.ring_mask;
-    struct io_uring_sqe *sqe = &s->sqes[index];
-    sqe->fd = file_fd;
-    sqe->flags = 0;
-    sqe->opcode = IORING_OP_READV;
-    sqe->addr = (unsigned long) fi->iovecs;
-    sqe->len = blocks;
-    sqe->off = 0;
-    sqe->user_data = (unsigned long long)fi;
-    sring->array[index] = index;
-    tail = next_tail;
-
-    // Update the tail so kernel can see it
-    if (*sring->tail != tail)
+    // the kernel can reuse the entries once head has moved past them
+    __atomic_store_n(cring->head, head, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// writes completed blocks in file order and hands their buffers back to the free list
+int write_completed(struct uring_reader *r)
+{
+    while (r->out_seq < r->next_seq)
     {
-        *sring->tail = tail;
-        write_barrier();
+        unsigned slot_index = r->order[r->out_seq % r->depth];
+        struct read_slot *slot = &r->slots[slot_index];
+        if (!slot->done) break;
+
+        unsigned written = 0;
+        while (written < slot->filled)
+        {
+            ssize_t ret = write(STDOUT_FILENO, slot->buf + written, slot->filled - written);
+            if (ret < 0)
+            {
+                perror("write");
+                return 1;
+            }
+            written += ret;
+        }
+        r->bytes += slot->filled;
+        r->free_slots[r->free_count++] = slot_index;
+        r->out_seq++;
     }
+    return 0;
+}
 
-    // Tell kernel we have submitted events with io_uring_enter() syscall
-    int ret = io_uring_enter(s->ring_fd, 1, 1, IORING_ENTER_GETEVENTS);
-    if (ret < 0)
+// queue a batch, one enter to submit it and wait for a quarter of the reads in flight, reap
+// them all, write what is in order, repeat, so the ring never runs empty while we write
+int read_all(struct uring_reader *r)
+{
+    for (;;)
     {
-        perror("io_uring_enter");
-        return 1;
+        queue_reads(r);
+        if (r->in_flight == 0) break;
+
+        unsigned wait_for = r->in_flight / 4 > 0 ? r->in_flight / 4 : 1;
+        if (submit_and_wait(r, wait_for) || reap_completions(r) || write_completed(r))
+        {
+            return 1;
+        }
     }
+    return write_completed(r);
+}
 
-    return 0;
+static double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
 }
 
 int main(int argc, char* argv[])
 {
-    struct submitter *s;
-    if (argc < 2)
+    struct uring_reader r;
+    memset(&r, 0, sizeof(r));
+    r.depth = QUEUE_DEPTH;
+    r.block_sz = BLOCK_SZ;
+    int stats = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:b:qs")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            r.depth = (unsigned) strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            r.block_sz = (unsigned) strtoul(optarg, NULL, 10) * 1024;
+            break;
+        case 'q':
+            r.sqpoll = 1;
+            break;
+        case 's':
+            stats = 1;
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (optind >= argc || r.depth < 1 || r.block_sz < 1)
     {
-        fprintf(stderr, "Usage: %s <filename1> [<filename2> ...]\n", argv[0]);
+        fprintf(stderr, "Usage: %s [-d queue depth] [-b block KB] [-q (SQPOLL)] [-s (stats)] <filename1> [<filename2> ...]\n", argv[0]);
         return 1;
     }
 
-    s = malloc(sizeof(*s));
-    if (!s)
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (app_setup_uring(&r) || register_buffers(&r) || register_files(&r, &argv[optind], argc - optind))
     {
-        perror("malloc");
+        fprintf(stderr, "Unable to setup uring\n");
         return 1;
     }
-    memset(s, 0, sizeof(*s));
-
-    if (app_setup_uring(s))
+    if (read_all(&r))
     {
-        fprintf(stderr, "Unable to setup uring");
+        fprintf(stderr, "Error reading file\n");
         return 1;
     }
 
-    for (int i = 1; i < argc; i++)
+    // syscalls on the read side only, the writes to stdout are one per block either way
+    if (stats)
     {
-        if(submit_to_sq(argv[i], s))
-        {
-            fprintf(stderr, "Error reading file\n");
-            return 1;
-        }
-        read_from_cq(s);
-        fputc('\n', stdout);
+        double seconds = seconds_since(&start);
+        double gb = r.bytes / 1e9;
+        fprintf(stderr, "%llu bytes, %llu io_uring_enter calls, %.1f per GB, %.3f s, %.2f GB/s%s\n",
+            r.bytes, r.enters, gb > 0 ? r.enters / gb : 0.0, seconds, gb / seconds, r.sqpoll ? " (SQPOLL)" : "");
     }
-
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,63 @@
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h> // pread
+#include <sys/stat.h>
+
+#include "columnar.h"
+#include "io_backend.h"
+
+// every input backend, --io picks one by name
+const IoBackend* const ioBackends[] = {
+    &stdioBackend,
+    &readBackend,
+    &mmapBackend,
+    &preadBackend,
+    &directBackend,
+    &streamBackend,
+#ifdef HAVE_LIBURING
+    &uringBackend,
+#endif
+};
+
+const size_t ioBackendCount = sizeof(ioBackends) / sizeof(ioBackends[0]);
+
+const IoBackend* findIoBackend(const char* name) {
+    for (size_t i = 0; i < ioBackendCount; i++) {
+        if (strcmp(ioBackends[i]->name, name) == 0) {
+            return ioBackends[i];
+        }
+    }
+    return NULL;
+}
+
+InputFormat detectInputFormat(const char* path) {
+    // a pipe's first bytes would be gone for the backend, and opening a fifo just to look can
+    // block or hand its writer an early EOF
+    struct stat st;
+    if (strcmp(path, "-") == 0 || stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return INPUT_TEXT;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return INPUT_TEXT; // the backend reports the open error
+    unsigned char magic[sizeof(COLUMNAR_MAGIC) - 1];
+    ssize_t length = pread(fd, magic, sizeof(magic), 0);
+    close(fd);
+    if (length == (ssize_t)sizeof(magic) && memcmp(magic, COLUMNAR_MAGIC, sizeof(magic)) == 0) return INPUT_COLUMNAR;
+    if (length >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return INPUT_GZIP;
+    if (length >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) return INPUT_ZSTD;
+    return INPUT_TEXT;
+}
+
+int runBackend(const IoBackend* backend, const IoOptions* options, WeatherStation* ws) {
+    if (options->pathCount <= 1 || backend->manyFiles) {
+        return backend->run(options, ws);
+    }
+    IoOptions single = *options;
+    single.pathCount = 1;
+    for (int i = 0; i < options->pathCount; i++) {
+        single.path = options->paths[i];
+        single.paths = &options->paths[i];
+        single.formats = &options->formats[i];
+        if (backend->run(&single, ws) != 0) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+#ifndef IO_BACKEND_H
+#define IO_BACKEND_H
+
+#include <sys/types.h> // off_t
+
+#include "weather_station.h"
+
+// what a path holds, told by its first bytes, read with pread so nothing is consumed
+// only a regular file is probed, "-", fifos, sockets and devices are always text
+typedef enum InputFormat {
+    INPUT_TEXT,
+    INPUT_COLUMNAR, // a conv output, read by columnarBackend
+    INPUT_GZIP,     // read by compressedBackend
+    INPUT_ZSTD,
+} InputFormat;
+
+InputFormat detectInputFormat(const char* path);
+
+// everything a backend needs to know about the run, filled in from the command line
+typedef struct IoOptions {
+    const char* path;
+    // more than one input (a file list or glob), every path is aggregated into the same table,
+    // path is paths[0], a backend without manyFiles is run once per path by runBackend
+    const char* const* paths;
+    int pathCount;
+    // detectInputFormat of each path (pathCount of them, one for path alone), probed once up front by the caller
+    const InputFormat* formats;
+    long threads;
+    unsigned queueDepth; // reads kept in flight by the uring and direct backends
+    // mmap backend tuning, all off by default
+    int mapPopulate;  // MAP_POPULATE, fault the whole file in inside mmap()
+    int madviseHints; // MMAP_ADVISE_* bits passed to madvise() on the mapping
+    int prefault;     // each thread touches every page of a chunk before parsing it
+    // chunk scheduler, used by the mmap, pread and direct backends
+    size_t chunkSize; // bytes per chunk handed out by the atomic cursor, at least 1, IO_CHUNK_SIZE by default
+    int threadStats;  // print every thread's chunk count and busy/idle time to stderr
+    // only [startOffset, endOffset) of the file is aggregated, resuming from a snapshot sets it
+    // startOffset must be a row start and endOffset just past a '\n', 0 means the end of the file
+    off_t startOffset;
+    off_t endOffset;
+    // the process exits right after the run (the --fork child), mappings are left to the kernel
+    int keepMapping;
+} IoOptions;
+
+#define MMAP_ADVISE_SEQUENTIAL 1
+#define MMAP_ADVISE_WILLNEED   2
+#define MMAP_ADVISE_HUGEPAGE   4
+
+// parses a comma separated --madvise list like "sequential,hugepage", returns 0 on success
+int parseMadviseHints(const char* list, int* hints);
+
+// an input backend only decides how bytes get into memory, every backend feeds them
+// to processRows from parse.h and aggregates into the WeatherStation it is given
+typedef struct IoBackend {
+    const char* name;
+    // returns 0 on success, prints its own error and returns non zero otherwise
+    int (*run)(const IoOptions* options, WeatherStation* ws);
+    int manyFiles; // run reads every one of options->paths itself
+} IoBackend;
+
+extern const IoBackend stdioBackend; // fread into a large buffer, libc buffering on top
+extern const IoBackend readBackend;  // plain read() syscalls, no libc buffer
+extern const IoBackend mmapBackend;  // whole file mapped, chunks parsed in place by the threads
+extern const IoBackend preadBackend; // threads pread() the chunks they claim into their own buffers
+extern const IoBackend directBackend; // pread with O_DIRECT into aligned buffers, bypasses the page cache
+extern const IoBackend streamBackend; // stdin or a pipe, reading overlaps parsing
+// not a text backend and not in ioBackends, picked whenever the input is a conv output
+extern const IoBackend columnarBackend;
+// not in ioBackends either, picked whenever an input is gzip or zstd (io_compressed.c)
+extern const IoBackend compressedBackend;
+#ifdef HAVE_LIBURING
+extern const IoBackend uringBackend; // queued io_uring reads, parsed as they complete
+#endif
+
+// the registered backends in the order usage lists them, and lookup by --io name
+extern const IoBackend* const ioBackends[];
+extern const size_t ioBackendCount;
+const IoBackend* findIoBackend(const char* name);
+
+// backend->run over options->paths, one file after the other into ws unless the backend
+// takes them all at once, returns non zero as soon as one file fails
+int runBackend(const IoBackend* backend, const IoOptions* options, WeatherStation* ws);
+
+// where the range ends in a file of size bytes
+static inline off_t rangeEnd(const IoOptions* options, off_t size) {
+    return options->endOffset > 0 && options->endOffset < size ? options->endOffset : size;
+}
+
+// bytes left to read in the range, or no limit when it runs to the end of the file
+static inline size_t rangeLength(const IoOptions* options) {
+    return options->endOffset > 0 ? (size_t)(options->endOffset - options->startOffset) : (size_t)-1;
+}
+
+// size of the buffer the read based backends refill, rows left over are carried to the front
+#define IO_BUFFER_SIZE (1 << 20)
+
+// default chunk for the threaded backends, small enough that the last chunks even out the
+// threads, big enough that the cursor is touched a few thousand times for a 13GB file
+#define IO_CHUNK_SIZE (4 << 20)
+
+#endif
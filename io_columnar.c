@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "columnar.h"
+#include "io_backend.h"
+#include "stats.h"
+#include "io_scheduler.h"
+
+// aggregates a file written by conv, no text is scanned, the threads pull runs of blocks from
+// the same chunk cursor as mmap and fold one record per station run into their tables
+
+typedef struct ColumnarStation {
+    const char* name; // in the mapping, not NUL terminated
+    uint32_t length;
+    uint32_t hash;
+} ColumnarStation;
+
+typedef struct ColumnarFile {
+    const char* data;
+    const ColumnarHeader* header;
+    ColumnarStation* stations;
+} ColumnarFile;
+
+// min, max and sum of one station's run, no branches and no stores in the loop so it
+// vectorizes, a run is at most one block but conv takes any --block-rows, so the sum is int64
+static inline void reduceRun(const int16_t* temps, uint32_t count, TemperatureRecord* record) {
+    int16_t minTemp = INT16_MAX;
+    int16_t maxTemp = INT16_MIN;
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        minTemp = temps[i] < minTemp ? temps[i] : minTemp;
+        maxTemp = temps[i] > maxTemp ? temps[i] : maxTemp;
+        sum += temps[i];
+    }
+    record->minTemp = minTemp;
+    record->maxTemp = maxTemp;
+    record->totalTemp = sum;
+    record->numRecords = count;
+}
+
+// chunks count blocks here, not bytes
+static int processColumnarBlocks(Worker* worker, off_t start, off_t end) {
+    const ColumnarFile* file = (const ColumnarFile*)worker->context;
+    const ColumnarHeader* header = file->header;
+
+    for (off_t block = start; block < end; block++) {
+        uint64_t firstRow = (uint64_t)block * header->blockRows;
+        uint32_t rows = header->rowCount - firstRow < header->blockRows ? (uint32_t)(header->rowCount - firstRow) : header->blockRows;
+        const char* blockData = file->data + header->dataOffset + firstRow * (sizeof(uint16_t) + sizeof(int16_t));
+        const uint16_t* ids = (const uint16_t*)blockData;
+        const int16_t* temps = (const int16_t*)(blockData + rows * sizeof(uint16_t));
+        COUNT_HOT(&worker->ws, bytesParsed, rows * (sizeof(uint16_t) + sizeof(int16_t)));
+
+        for (uint32_t i = 0; i < rows; ) {
+            uint16_t id = ids[i];
+            uint32_t runEnd = i + 1;
+            while (runEnd < rows && ids[runEnd] == id) runEnd++;
+            if (id >= header->stationCount) {
+                fprintf(stderr, "columnar: station id %u out of range\n", id);
+                return 1;
+            }
+
+            TemperatureRecord record;
+            reduceRun(temps + i, runEnd - i, &record);
+            COUNT_HOT(&worker->ws, rows, runEnd - i);
+            const ColumnarStation* station = &file->stations[id];
+            StationSlot* slot = mergeStation(&worker->ws, station->name, station->length, station->hash, &record);
+            if (worker->ws.histograms != NULL) {
+                uint32_t* histogram = stationHistogram(&worker->ws, slot);
+                for (uint32_t r = i; r < runEnd; r++) histogram[temps[r] + HISTOGRAM_OFFSET]++;
+            }
+            i = runEnd;
+        }
+    }
+    return 0;
+}
+
+// checks the header against the file size and indexes the dictionary, returns 0 on success
+static int openColumnar(ColumnarFile* file, off_t size) {
+    const ColumnarHeader* header = file->header;
+    uint64_t blockBytes = header->rowCount * (sizeof(uint16_t) + sizeof(int16_t));
+    if (header->blockRows == 0 || header->stationCount > COLUMNAR_MAX_STATIONS ||
+        header->dataOffset < sizeof(ColumnarHeader) || header->dataOffset % sizeof(uint16_t) != 0 ||
+        header->dictionaryOffset != header->dataOffset + blockBytes || header->dictionaryOffset > (uint64_t)size) {
+        fprintf(stderr, "columnar: corrupt header\n");
+        return 1;
+    }
+
+    file->stations = (ColumnarStation*)calloc(header->stationCount + 1, sizeof(ColumnarStation));
+    if (file->stations == NULL) {
+        perror("calloc failed");
+        return 1;
+    }
+    const char* p = file->data + header->dictionaryOffset;
+    const char* end = file->data + size;
+    for (uint32_t id = 0; id < header->stationCount; id++) {
+        if (p >= end || *p == 0 || end - p - 1 < (unsigned char)*p) {
+            fprintf(stderr, "columnar: corrupt dictionary\n");
+            return 1;
+        }
+        file->stations[id].length = (unsigned char)*p;
+        file->stations[id].name = p + 1;
+        file->stations[id].hash = hashName(p + 1, file->stations[id].length);
+        p += 1 + file->stations[id].length;
+    }
+    return 0;
+}
+
+static int runColumnar(const IoOptions* options, WeatherStation* ws) {
+    enterPhase(PHASE_MAP);
+    int fd = open(options->path, O_RDONLY);
+    if (fd < 0) {
+        perror("open failed");
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat error");
+        close(fd);
+        return 1;
+    }
+    if (st.st_size < (off_t)sizeof(ColumnarHeader)) {
+        fprintf(stderr, "columnar: %s is too short\n", options->path);
+        close(fd);
+        return 1;
+    }
+
+    char* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | (options->mapPopulate ? MAP_POPULATE : 0), fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        close(fd);
+        return 1;
+    }
+
+    ColumnarFile file = { data, (const ColumnarHeader*)data, NULL };
+    int failed = openColumnar(&file, st.st_size);
+    if (!failed) {
+        // the cursor counts blocks, --chunk-size still sets how many bytes a thread claims at once
+        IoOptions blocks = *options;
+        uint64_t blockBytes = (uint64_t)file.header->blockRows * (sizeof(uint16_t) + sizeof(int16_t));
+        blocks.chunkSize = options->chunkSize > blockBytes ? options->chunkSize / blockBytes : 1;
+        off_t blockCount = (file.header->rowCount + file.header->blockRows - 1) / file.header->blockRows;
+        failed = runWorkers(&blocks, ws, 0, blockCount, &file, processColumnarBlocks);
+    }
+
+    enterPhase(PHASE_MAP);
+    free(file.stations);
+    if (!options->keepMapping) {
+        munmap(data, st.st_size);
+    }
+    close(fd);
+    return failed;
+}
+
+const IoBackend columnarBackend = { "columnar", runColumnar, 0 };
@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "io_stream.h"
+#include "stats.h"
+
+// gzip (-DHAVE_ZLIB -lz) and zstd (-DHAVE_ZSTD -lzstd) inputs are read without a temporary
+// file: the stream backend's reader thread decompresses straight into the buffers the parser
+// takes from it, so decompressing and parsing run at the same time and the uncompressed bytes
+// only ever exist in those two buffers
+
+// compressed bytes are read from the file this much at a time
+#define COMPRESSED_READ_SIZE (256 * 1024)
+typedef struct Decoder {
+    int fd;
+    char* input;
+    size_t inputLength;
+    size_t inputPos;
+    int inputEnd;   // the file has been read to its end
+    int atFrameEnd; // the last thing decoded ended a gzip member or zstd frame, a clean place to stop
+#ifdef HAVE_ZLIB
+    z_stream gzip;
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx* zstd;
+#endif
+} Decoder;
+
+#if defined(HAVE_ZLIB) || defined(HAVE_ZSTD)
+// reads the next compressed block once the decoder has used up the last one
+static int readInput(Decoder* decoder) {
+    if (decoder->inputPos < decoder->inputLength || decoder->inputEnd) return 0;
+    ssize_t bytesRead = read(decoder->fd, decoder->input, COMPRESSED_READ_SIZE);
+    if (bytesRead < 0) {
+        perror("read failed");
+        return 1;
+    }
+    decoder->inputLength = bytesRead;
+    decoder->inputPos = 0;
+    decoder->inputEnd = bytesRead == 0;
+    return 0;
+}
+
+// a short fill means the file ended, if that was inside a member or frame the input was cut
+// short and the rows so far would look complete
+static ssize_t finishFill(const Decoder* decoder, size_t filled, size_t capacity, const char* format) {
+    if (filled < capacity && !decoder->atFrameEnd) {
+        fprintf(stderr, "%s: input is truncated\n", format);
+        return -1;
+    }
+    return filled;
+}
+#endif
+
+#ifdef HAVE_ZLIB
+static ssize_t fillGzip(void* state, char* buffer, size_t capacity) {
+    Decoder* decoder = (Decoder*)state;
+    z_stream* gzip = &decoder->gzip;
+    gzip->next_out = (Bytef*)buffer;
+    gzip->avail_out = capacity;
+    while (gzip->avail_out > 0) {
+        if (readInput(decoder) != 0) return -1;
+        gzip->next_in = (Bytef*)decoder->input + decoder->inputPos;
+        gzip->avail_in = decoder->inputLength - decoder->inputPos;
+        uInt outBefore = gzip->avail_out;
+        uInt inBefore = gzip->avail_in;
+
+        // inflate also runs with no new input, it may still hold output from the last call
+        int ret = inflate(gzip, Z_NO_FLUSH);
+        decoder->inputPos = decoder->inputLength - gzip->avail_in;
+        if (ret == Z_STREAM_END) {
+            // pigz and cat a.gz b.gz write several members, they decode as one stream
+            decoder->atFrameEnd = 1;
+            inflateReset(gzip);
+        } else if (ret == Z_OK) {
+            decoder->atFrameEnd = 0;
+        } else if (ret != Z_BUF_ERROR) {
+            fprintf(stderr, "gzip: %s\n", gzip->msg != NULL ? gzip->msg : "corrupt input");
+            return -1;
+        }
+        if (gzip->avail_out == outBefore && gzip->avail_in == inBefore && decoder->inputEnd) break;
+    }
+    return finishFill(decoder, capacity - gzip->avail_out, capacity, "gzip");
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static ssize_t fillZstd(void* state, char* buffer, size_t capacity) {
+    Decoder* decoder = (Decoder*)state;
+    ZSTD_outBuffer out = { buffer, capacity, 0 };
+    while (out.pos < out.size) {
+        if (readInput(decoder) != 0) return -1;
+        ZSTD_inBuffer in = { decoder->input, decoder->inputLength, decoder->inputPos };
+        size_t outBefore = out.pos;
+
+        // one frame after another, a return of 0 means the frame just ended
+        size_t ret = ZSTD_decompressStream(decoder->zstd, &out, &in);
+        if (ZSTD_isError(ret)) {
+            fprintf(stderr, "zstd: %s\n", ZSTD_getErrorName(ret));
+            return -1;
+        }
+        int progress = in.pos != decoder->inputPos || out.pos != outBefore;
+        decoder->inputPos = in.pos;
+        if (!progress && decoder->inputEnd) break;
+        decoder->atFrameEnd = ret == 0;
+    }
+    return finishFill(decoder, out.pos, capacity, "zstd");
+}
+#endif
+
+// sets the decoder up for format and points source at it, returns 0 on success and 1
+// when this build can't read the format
+static int openDecoder(Decoder* decoder, InputFormat format, StreamSource* source) {
+    source->state = decoder;
+    switch (format) {
+    case INPUT_GZIP:
+#ifdef HAVE_ZLIB
+        memset(&decoder->gzip, 0, sizeof(decoder->gzip));
+        // 15 window bits plus 16 reads the gzip wrapper instead of a raw zlib stream
+        if (inflateInit2(&decoder->gzip, 15 + 16) != Z_OK) {
+            fprintf(stderr, "gzip: inflateInit2 failed\n");
+            return 1;
+        }
+        source->fill = fillGzip;
+        return 0;
+#else
+        fprintf(stderr, "gzip input needs a build with -DHAVE_ZLIB -lz\n");
+        return 1;
+#endif
+    case INPUT_ZSTD:
+#ifdef HAVE_ZSTD
+        decoder->zstd = ZSTD_createDCtx();
+        if (decoder->zstd == NULL) {
+            fprintf(stderr, "zstd: ZSTD_createDCtx failed\n");
+            return 1;
+        }
+        source->fill = fillZstd;
+        return 0;
+#else
+        fprintf(stderr, "zstd input needs a build with -DHAVE_ZSTD -lzstd\n");
+        return 1;
+#endif
+    default:
+        return 1;
+    }
+}
+
+static void closeDecoder(Decoder* decoder, InputFormat format) {
+#ifdef HAVE_ZLIB
+    if (format == INPUT_GZIP) inflateEnd(&decoder->gzip);
+#endif
+#ifdef HAVE_ZSTD
+    if (format == INPUT_ZSTD) ZSTD_freeDCtx(decoder->zstd);
+#endif
+    (void)decoder;
+    (void)format;
+}
+
+static int runCompressed(const IoOptions* options, WeatherStation* ws) {
+    // a list can mix compressed and plain files, the plain ones go through the same pipeline,
+    // the format was probed when the inputs were listed, a fifo is never probed and is plain
+    InputFormat format = options->formats[0];
+    if (format != INPUT_GZIP && format != INPUT_ZSTD) {
+        return streamBackend.run(options, ws);
+    }
+
+    enterPhase(PHASE_MAP);
+    Decoder decoder;
+    memset(&decoder, 0, sizeof(decoder));
+    decoder.fd = open(options->path, O_RDONLY);
+    if (decoder.fd < 0) {
+        perror("open failed");
+        return 1;
+    }
+
+    decoder.input = (char*)malloc(COMPRESSED_READ_SIZE);
+    if (decoder.input == NULL) {
+        perror("malloc failed");
+        close(decoder.fd);
+        return 1;
+    }
+    StreamSource source;
+    int failed = openDecoder(&decoder, format, &source);
+    if (!failed) {
+        failed = runStreamSource(ws, &source);
+        closeDecoder(&decoder, format);
+    }
+
+    free(decoder.input);
+    close(decoder.fd);
+    return failed;
+}
+
+const IoBackend compressedBackend = { "compressed", runCompressed, 0 };
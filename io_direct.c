@@ -0,0 +1,116 @@
+#define _GNU_SOURCE // O_DIRECT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h> // pread
+#include <sys/stat.h>
+
+#include "io_backend.h"
+#include "stats.h"
+#include "io_scheduler.h"
+#include "parse.h"
+
+// pread with O_DIRECT, the device DMAs straight into our buffers and the page cache is never
+// filled, so a cold run doesn't evict everything else cached on the machine for a file that is
+// read once, every worker keeps one aligned buffer for the whole run and reuses it for each
+// chunk it claims, --queue-depth workers (or --threads if that is more) means that many reads in
+// flight, a parse thread blocked on the disk leaves its cpu to the others
+
+// offsets, lengths and buffer addresses must be multiples of the device's logical block size,
+// 512 or 4096 everywhere in practice
+#define DIRECT_ALIGN 4096
+
+typedef struct DirectFile {
+    int fd;
+    off_t end; // rows are never read past the end of the range
+} DirectFile;
+
+static inline off_t alignDown(off_t offset) {
+    return offset & ~(off_t)(DIRECT_ALIGN - 1);
+}
+
+static inline off_t alignUp(off_t offset) {
+    return alignDown(offset + DIRECT_ALIGN - 1);
+}
+
+// the same overlap as the pread backend (the byte before the chunk and MAX_ROW_SIZE after it),
+// widened to whole blocks, so the chunk starts a little into the buffer
+static int processDirectChunk(Worker* worker, off_t start, off_t end) {
+    const DirectFile* file = (const DirectFile*)worker->context;
+    off_t readStart = start == worker->cursor->begin ? start : start - 1;
+    off_t readEnd = end + MAX_ROW_SIZE < file->end ? end + MAX_ROW_SIZE : file->end;
+    off_t blockStart = alignDown(readStart);
+    size_t wanted = alignUp(readEnd) - blockStart;
+
+    if (worker->buffer == NULL) {
+        // big enough for any chunk: the chunk, its overlap and a block of rounding on each side
+        size_t capacity = alignUp(worker->cursor->chunkSize + MAX_ROW_SIZE + 1) + 2 * DIRECT_ALIGN;
+        void* buffer;
+        if (posix_memalign(&buffer, DIRECT_ALIGN, capacity) != 0) {
+            perror("posix_memalign");
+            return 1;
+        }
+        worker->buffer = (char*)buffer;
+    }
+
+    size_t filled = 0;
+    while (filled < wanted) {
+        ssize_t bytesRead = pread(file->fd, worker->buffer + filled, wanted - filled, blockStart + filled);
+        if (bytesRead < 0) {
+            perror("pread failed");
+            return 1;
+        }
+        filled += bytesRead;
+        // the unaligned tail of the file comes back as a short read, another read from there
+        // would not be aligned, and a read of 0 means the file shrank
+        if (bytesRead == 0 || bytesRead % DIRECT_ALIGN != 0) break;
+    }
+
+    // the last block read can run past the range into rows another snapshot run will parse
+    size_t valid = filled < (size_t)(readEnd - blockStart) ? filled : (size_t)(readEnd - blockStart);
+    const char* chunk = worker->buffer + (start - blockStart);
+    const char* chunkEnd = worker->buffer + (end - blockStart);
+    const char* limit = worker->buffer + valid;
+    if (chunkEnd > limit) chunkEnd = limit;
+    if (chunk < chunkEnd) {
+        processChunkRows(&worker->ws, chunk, chunkEnd, limit, readStart == start);
+    }
+    return 0;
+}
+
+static int runDirect(const IoOptions* options, WeatherStation* ws) {
+    enterPhase(PHASE_MAP);
+    int fd = open(options->path, O_RDONLY | O_DIRECT);
+    if (fd < 0 && errno == EINVAL) {
+        // tmpfs and some fuse filesystems have no direct io, the same aligned reads still work
+        fprintf(stderr, "direct: %s doesn't support O_DIRECT, reading through the page cache\n", options->path);
+        fd = open(options->path, O_RDONLY);
+    }
+    if (fd < 0) {
+        perror("open failed");
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror("fstat error");
+        close(fd);
+        return 1;
+    }
+
+    // whole blocks per chunk so neighbouring chunks share at most the block at each end, and
+    // a thread per read in flight since pread blocks
+    IoOptions direct = *options;
+    direct.chunkSize = alignUp(options->chunkSize);
+    direct.threads = options->threads > (long)options->queueDepth ? options->threads : (long)options->queueDepth;
+
+    DirectFile file = { fd, rangeEnd(options, st.st_size) };
+    int failed = runWorkers(&direct, ws, options->startOffset, file.end, &file, processDirectChunk);
+    close(fd);
+    return failed;
+}
+
+const IoBackend directBackend = { "direct", runDirect, 0 };
@@ -0,0 +1,134 @@
+#include <stdio.h> // printf, perror
+#include <string.h>
+#include <stdlib.h>
+
+// for IO system calls and file options
+#include <fcntl.h> // open(), O_RDONLY
+#include <unistd.h> // close()
+
+#include <sys/types.h> // size_t
+#include <sys/stat.h> // for fstat, struct stat
+#include <sys/mman.h> // for mmap, unmap, PROT_*, MAP_* macros
+
+#include "io_backend.h"
+#include "stats.h"
+#include "io_scheduler.h"
+#include "parse.h"
+
+// shared by every worker, chunks are parsed straight out of the mapping
+typedef struct Mapping {
+    const char* data;
+    off_t end; // rows are never read past the end of the range
+    int prefault;
+} Mapping;
+
+// reads one byte per page so the faults for this chunk are taken up front, in
+// parallel with the other threads, rather than spread through the parse loop
+static void prefaultRange(const char* begin, const char* end) {
+    long pageSize = sysconf(_SC_PAGESIZE);
+    volatile char sink = 0;
+    for (const char* p = begin; p < end; p += pageSize) {
+        sink += *(volatile const char*)p;
+    }
+    (void)sink;
+}
+
+// the whole file is mapped, so the byte before the chunk and the row crossing its end are
+// always readable and the chunk can be parsed in place
+static int processMappedChunk(Worker* worker, off_t start, off_t end) {
+    const Mapping* mapping = (const Mapping*)worker->context;
+    if (mapping->prefault) {
+        prefaultRange(mapping->data + start, mapping->data + end);
+    }
+    processChunkRows(&worker->ws, mapping->data + start, mapping->data + end, mapping->data + mapping->end, start == worker->cursor->begin);
+    return 0;
+}
+
+int parseMadviseHints(const char* list, int* hints) {
+    *hints = 0;
+    while (*list) {
+        size_t length = strcspn(list, ",");
+        if (length == 10 && strncmp(list, "sequential", length) == 0) {
+            *hints |= MMAP_ADVISE_SEQUENTIAL;
+        } else if (length == 8 && strncmp(list, "willneed", length) == 0) {
+            *hints |= MMAP_ADVISE_WILLNEED;
+        } else if (length == 8 && strncmp(list, "hugepage", length) == 0) {
+            *hints |= MMAP_ADVISE_HUGEPAGE;
+        } else {
+            fprintf(stderr, "unknown madvise hint: %.*s\n", (int)length, list);
+            return 1;
+        }
+        list += length;
+        if (*list == ',') list++;
+    }
+    return 0;
+}
+
+// hints are only advice, a kernel that refuses one (hugepages on a filesystem without
+// read only THP support for example) still gets a correct run, just a warning
+static void adviseMapping(char* data, size_t size, int hints) {
+    if ((hints & MMAP_ADVISE_SEQUENTIAL) && madvise(data, size, MADV_SEQUENTIAL) != 0) {
+        perror("madvise(MADV_SEQUENTIAL)");
+    }
+    if ((hints & MMAP_ADVISE_WILLNEED) && madvise(data, size, MADV_WILLNEED) != 0) {
+        perror("madvise(MADV_WILLNEED)");
+    }
+    if ((hints & MMAP_ADVISE_HUGEPAGE) && madvise(data, size, MADV_HUGEPAGE) != 0) {
+        perror("madvise(MADV_HUGEPAGE)");
+    }
+}
+
+static int runMmap(const IoOptions* options, WeatherStation* ws) {
+    enterPhase(PHASE_MAP);
+    // other options include: O_DIRECT, O_SYNC, O_CREAT
+    int fd = open(options->path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("open failed");
+        return 1;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) == -1) {
+        perror("fstat error");
+        close(fd);
+        return 1;
+    }
+
+    // mmap of length 0 fails, an empty file simply has no rows
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    // MAP_POPULATE reads the whole file in up front instead of one 4KB fault at a time
+    int flags = MAP_PRIVATE | (options->mapPopulate ? MAP_POPULATE : 0);
+    char* data = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        close(fd);
+        return 1;
+    }
+    adviseMapping(data, st.st_size, options->madviseHints);
+
+    // many small chunks pulled by the threads as they go, each thread aggregates its own table
+    Mapping mapping = { data, rangeEnd(options, st.st_size), options->prefault };
+    int failed = runWorkers(options, ws, options->startOffset, mapping.end, &mapping, processMappedChunk);
+
+    // tearing down the page tables of a big mapping is not free
+    enterPhase(PHASE_MAP);
+
+    close(fd);
+    if (!options->keepMapping) {
+        munmap(data, st.st_size);
+    }
+    return failed;
+}
+
+const IoBackend mmapBackend = { "mmap", runMmap, 0 };
+
+
+// mmap creates a new mapping in virtual address space of the process, this avoids syscalls for IO and process can read from its own memory like array
+// MAP_SHARED: share this mapping i.e updates are visible to other processes mapping the same region and in case of file backed mapping are carried through to the underlying file.
+// MAP_PRIVATE: private copy on write mapping for this process. Updates not visible to other processes mapping the same file and not carried to the underlying file.
+// MAP_ANONYMOUS: not backed by file. fd = -1, just get some memory
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fcntl.h>
+#include <unistd.h> // pread
+#include <sys/stat.h>
+
+#include "io_backend.h"
+#include "stats.h"
+#include "io_scheduler.h"
+#include "parse.h"
+
+// the threaded counterpart of the read backend, every worker pread()s the chunks it claims
+// into its own buffer, no mapping and no page faults, the copy out of the page cache is
+// spread over all the threads
+
+typedef struct PreadFile {
+    int fd;
+    off_t end; // rows are never read past the end of the range
+} PreadFile;
+
+// the read covers the byte before the chunk and MAX_ROW_SIZE after it, the same overlap
+// the uring backend uses, so the chunk is parsed without looking at its neighbours
+static int processReadChunk(Worker* worker, off_t start, off_t end) {
+    const PreadFile* file = (const PreadFile*)worker->context;
+    if (worker->buffer == NULL) {
+        worker->buffer = (char*)malloc(worker->cursor->chunkSize + MAX_ROW_SIZE + 1);
+        if (worker->buffer == NULL) {
+            perror("malloc failed");
+            return 1;
+        }
+    }
+
+    off_t readStart = start == worker->cursor->begin ? start : start - 1;
+    off_t readEnd = end + MAX_ROW_SIZE < file->end ? end + MAX_ROW_SIZE : file->end;
+    size_t filled = 0;
+    while (filled < (size_t)(readEnd - readStart)) {
+        ssize_t bytesRead = pread(file->fd, worker->buffer + filled, readEnd - readStart - filled, readStart + filled);
+        if (bytesRead < 0) {
+            perror("pread failed");
+            return 1;
+        }
+        if (bytesRead == 0) break; // the file shrank, parse what is there
+        filled += bytesRead;
+    }
+
+    const char* chunk = worker->buffer + (start - readStart);
+    processChunkRows(&worker->ws, chunk, chunk + (end - start), worker->buffer + filled, readStart == start);
+    return 0;
+}
+
+static int runPread(const IoOptions* options, WeatherStation* ws) {
+    enterPhase(PHASE_MAP);
+    int fd = open(options->path, O_RDONLY);
+    if (fd < 0) {
+        perror("open failed");
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror("fstat error");
+        close(fd);
+        return 1;
+    }
+
+    PreadFile file = { fd, rangeEnd(options, st.st_size) };
+    int failed = runWorkers(options, ws, options->startOffset, file.end, &file, processReadChunk);
+    close(fd);
+    return failed;
+}
+
+const IoBackend preadBackend = { "pread", runPread, 0 };
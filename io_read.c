@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+// for IO system calls and options
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "io_backend.h"
+#include "stats.h"
+#include "parse.h"
+
+// low level system calls vs fopen, fread and not buffered too
+static int runRead(const IoOptions* options, WeatherStation* ws) {
+    enterPhase(PHASE_MAP);
+    int fd = open(options->path, O_RDONLY);
+    if (fd < 0) {
+        perror("open failed");
+        return 1;
+    }
+
+    char* buffer = (char*)malloc(IO_BUFFER_SIZE);
+    if (buffer == NULL) {
+        perror("malloc failed");
+        close(fd);
+        return 1;
+    }
+
+    if (options->startOffset > 0 && lseek(fd, options->startOffset, SEEK_SET) < 0) {
+        perror("lseek failed");
+        free(buffer);
+        close(fd);
+        return 1;
+    }
+
+    // a row cut by the end of one read is carried to the front and completed by the next
+    enterPhase(PHASE_SCAN);
+    size_t remaining = rangeLength(options);
+    size_t carry = 0;
+    ssize_t bytesRead = 0;
+    while (remaining > 0) {
+        size_t wanted = IO_BUFFER_SIZE - carry < remaining ? IO_BUFFER_SIZE - carry : remaining;
+        if ((bytesRead = read(fd, buffer + carry, wanted)) <= 0) break;
+        remaining -= bytesRead;
+        carry = processBuffer(ws, buffer, carry + bytesRead);
+    }
+
+    if (bytesRead < 0) {
+        perror("read failed");
+    }
+
+    // the last row may have no trailing newline
+    processRows(ws, buffer, buffer + carry);
+
+    free(buffer);
+    close(fd);
+    return bytesRead < 0;
+}
+
+const IoBackend readBackend = { "read", runRead, 0 };
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "io_scheduler.h"
+#include "stats.h"
+
+static double secondsSince(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+typedef struct WorkerStart {
+    Worker* worker;
+    const struct timespec* runStart;
+} WorkerStart;
+
+static void* workerThread(void* arg) {
+    Worker* worker = ((WorkerStart*)arg)->worker;
+    const struct timespec* runStart = ((WorkerStart*)arg)->runStart;
+
+    off_t start, end;
+    while (nextChunk(worker->cursor, &start, &end)) {
+        struct timespec chunkStart;
+        clock_gettime(CLOCK_MONOTONIC, &chunkStart);
+        if (worker->processChunk(worker, start, end) != 0) {
+            worker->failed = 1;
+        }
+        worker->busy += secondsSince(&chunkStart);
+        worker->chunks++;
+    }
+    worker->finished = secondsSince(runStart);
+    return NULL;
+}
+
+int runWorkers(const IoOptions* options, WeatherStation* ws, off_t begin, off_t end, void* context,
+               int (*processChunk)(Worker* worker, off_t start, off_t end)) {
+    ChunkCursor cursor;
+    atomic_init(&cursor.next, begin);
+    cursor.begin = begin;
+    cursor.end = end;
+    cursor.chunkSize = (off_t)options->chunkSize;
+
+    long threadCount = options->threads;
+    Worker* workers = (Worker*)calloc(threadCount, sizeof(Worker));
+    WorkerStart* starts = (WorkerStart*)calloc(threadCount, sizeof(WorkerStart));
+    if (workers == NULL || starts == NULL) {
+        perror("calloc failed");
+        free(workers);
+        free(starts);
+        return 1;
+    }
+
+    enterPhase(PHASE_SCAN);
+    struct timespec runStart;
+    clock_gettime(CLOCK_MONOTONIC, &runStart);
+
+    long started = 0;
+    int failed = 0;
+    for (long t = 0; t < threadCount; t++) {
+        workers[t].cursor = &cursor;
+        workers[t].context = context;
+        workers[t].processChunk = processChunk;
+        starts[t].worker = &workers[t];
+        starts[t].runStart = &runStart;
+        initWeatherStationLike(&workers[t].ws, ws);
+        if (pthread_create(&workers[t].thread, NULL, workerThread, &starts[t]) != 0) {
+            // the threads already running still drain the whole cursor
+            perror("pthread_create");
+            freeWeatherStation(&workers[t].ws);
+            failed = started == 0;
+            break;
+        }
+        started++;
+    }
+
+    for (long t = 0; t < started; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+
+    enterPhase(PHASE_MERGE);
+    for (long t = 0; t < started; t++) {
+        mergeWeatherStation(ws, &workers[t].ws);
+        freeWeatherStation(&workers[t].ws);
+        free(workers[t].buffer);
+        failed |= workers[t].failed;
+    }
+
+    // idle is everything but busy up to the last worker's finish, waiting on the cursor
+    // and sitting done while the slowest thread works through its last chunk
+    if (options->threadStats) {
+        double wall = 0;
+        for (long t = 0; t < started; t++) {
+            if (workers[t].finished > wall) wall = workers[t].finished;
+        }
+        for (long t = 0; t < started; t++) {
+            fprintf(stderr, "thread %ld: %ld chunks, busy %.3fs, idle %.3fs\n",
+                t, workers[t].chunks, workers[t].busy, wall - workers[t].busy);
+        }
+    }
+
+    free(workers);
+    free(starts);
+    return failed;
+}
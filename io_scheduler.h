@@ -0,0 +1,50 @@
+#ifndef IO_SCHEDULER_H
+#define IO_SCHEDULER_H
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/types.h> // off_t
+
+#include "io_backend.h"
+
+// the file is cut into many small chunks handed out by one atomic cursor, a thread that
+// finishes early just takes the next chunk, so slices that run at different speeds (cold
+// pages, SMT siblings, noisy neighbours) no longer leave the other threads idle at the end
+// chunk boundaries are plain byte offsets, processChunkRows makes them newline aligned
+typedef struct ChunkCursor {
+    atomic_llong next;
+    off_t begin; // the first chunk starts on a row, the others finish the row cut at their start
+    off_t end;
+    off_t chunkSize;
+} ChunkCursor;
+
+// one parse thread, its table is private and merged after join
+typedef struct Worker {
+    WeatherStation ws;
+    pthread_t thread;
+    ChunkCursor* cursor;
+    void* context; // backend state shared by every worker, the mapping or the fd
+    char* buffer;  // per worker scratch for backends that read, freed by runWorkers
+    int (*processChunk)(struct Worker* worker, off_t start, off_t end);
+    long chunks;
+    double busy;     // seconds inside processChunk
+    double finished; // seconds from the start of the run until the cursor ran dry
+    int failed;
+} Worker;
+
+// claims [start, end) of the next chunk, returns 0 once the file is used up
+static inline int nextChunk(ChunkCursor* cursor, off_t* start, off_t* end) {
+    off_t begin = atomic_fetch_add_explicit(&cursor->next, cursor->chunkSize, memory_order_relaxed);
+    if (begin >= cursor->end) return 0;
+    *start = begin;
+    *end = begin + cursor->chunkSize < cursor->end ? begin + cursor->chunkSize : cursor->end;
+    return 1;
+}
+
+// runs options->threads workers over [begin, end) until the cursor is empty, merges their
+// tables into ws and with options->threadStats prints each worker's busy and idle time
+// processChunk returns non zero to fail the run, the other chunks are still drained
+int runWorkers(const IoOptions* options, WeatherStation* ws, off_t begin, off_t end, void* context,
+               int (*processChunk)(Worker* worker, off_t start, off_t end));
+
+#endif
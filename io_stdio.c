@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "io_backend.h"
+#include "stats.h"
+#include "parse.h"
+
+// using high level library calls like fread, extra libc overhead and 2 userspace memory buffers
+static int runStdio(const IoOptions* options, WeatherStation* ws) {
+    enterPhase(PHASE_MAP);
+    FILE* file = fopen(options->path, "r");
+    if (file == NULL) {
+        perror("fopen failed");
+        return 1;
+    }
+
+    char* buffer = (char*)malloc(IO_BUFFER_SIZE);
+    if (buffer == NULL) {
+        perror("malloc failed");
+        fclose(file);
+        return 1;
+    }
+
+    if (options->startOffset > 0 && fseeko(file, options->startOffset, SEEK_SET) != 0) {
+        perror("fseeko failed");
+        free(buffer);
+        fclose(file);
+        return 1;
+    }
+
+    enterPhase(PHASE_SCAN);
+    size_t remaining = rangeLength(options);
+    size_t carry = 0;
+    size_t bytesRead;
+    while (remaining > 0) {
+        size_t wanted = IO_BUFFER_SIZE - carry < remaining ? IO_BUFFER_SIZE - carry : remaining;
+        if ((bytesRead = fread(buffer + carry, 1, wanted, file)) == 0) break;
+        remaining -= bytesRead;
+        carry = processBuffer(ws, buffer, carry + bytesRead);
+    }
+
+    int failed = ferror(file);
+    if (failed) {
+        perror("fread failed");
+    }
+
+    // the last row may have no trailing newline
+    processRows(ws, buffer, buffer + carry);
+
+    free(buffer);
+    fclose(file);
+    return failed;
+}
+
+const IoBackend stdioBackend = { "stdio", runStdio, 0 };
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "io_stream.h"
+#include "stats.h"
+#include "parse.h"
+
+// reads from stdin ("-") or any fd that can't be mapped or sized up front, like a pipe from a
+// decompressor or a socket, a reader thread fills one buffer while the parser works on the other
+// the reader thread takes its bytes from a StreamSource, so io_compressed.c decompresses there
+
+#define STREAM_BUFFER_COUNT 2
+
+typedef struct StreamBuffer {
+    char* data;
+    size_t length;
+    int full; // set by the reader, cleared by the parser once the rows are aggregated
+} StreamBuffer;
+
+typedef struct Stream {
+    const StreamSource* source;
+    StreamBuffer buffers[STREAM_BUFFER_COUNT];
+    int eof; // no more buffers will be filled after the ones marked full
+    int failed;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} Stream;
+
+typedef struct FdSource {
+    int fd;
+    size_t remaining; // bytes left in the range, only a regular file can have a range
+} FdSource;
+
+// fills the buffer completely unless the input ends first, pipes hand out a few KB per read
+static ssize_t fillFromFd(void* state, char* buffer, size_t capacity) {
+    FdSource* source = (FdSource*)state;
+    if (capacity > source->remaining) capacity = source->remaining;
+    size_t filled = 0;
+    while (filled < capacity) {
+        ssize_t bytesRead = read(source->fd, buffer + filled, capacity - filled);
+        if (bytesRead < 0) {
+            perror("read failed");
+            return -1;
+        }
+        if (bytesRead == 0) break;
+        filled += bytesRead;
+    }
+    source->remaining -= filled;
+    return filled;
+}
+
+static void* readerThread(void* arg) {
+    Stream* stream = (Stream*)arg;
+    for (int next = 0; ; next = (next + 1) % STREAM_BUFFER_COUNT) {
+        StreamBuffer* buffer = &stream->buffers[next];
+
+        pthread_mutex_lock(&stream->lock);
+        while (buffer->full) {
+            pthread_cond_wait(&stream->changed, &stream->lock);
+        }
+        pthread_mutex_unlock(&stream->lock);
+
+        // the read (or the decompression) happens outside the lock, this is the overlap with parsing
+        ssize_t filled = stream->source->fill(stream->source->state, buffer->data, IO_BUFFER_SIZE);
+
+        pthread_mutex_lock(&stream->lock);
+        if (filled < 0) {
+            stream->failed = 1;
+            stream->eof = 1;
+        } else if (filled == 0) {
+            stream->eof = 1;
+        } else {
+            buffer->length = filled;
+            buffer->full = 1;
+            stream->eof = filled < IO_BUFFER_SIZE;
+        }
+        pthread_cond_broadcast(&stream->changed);
+        int done = stream->eof;
+        pthread_mutex_unlock(&stream->lock);
+
+        if (done) return NULL;
+    }
+}
+
+// parses one buffer, a row cut by the previous buffer's end is stitched together in carry first
+// so the big buffers are never copied, only the at most MAX_ROW_SIZE bytes of the split row
+static int parseStreamBuffer(WeatherStation* ws, char* carry, size_t* carryLength, const char* p, const char* end) {
+    if (*carryLength > 0) {
+        const char* newline = findByte(p, end, '\n');
+        const char* rowEnd = newline < end ? newline + 1 : end;
+        if (*carryLength + (rowEnd - p) > MAX_ROW_SIZE) {
+            fprintf(stderr, "row longer than %d bytes\n", MAX_ROW_SIZE);
+            return 1;
+        }
+        memcpy(carry + *carryLength, p, rowEnd - p);
+        *carryLength += rowEnd - p;
+        if (newline == end) return 0; // still no full row, keep collecting
+
+        processRows(ws, carry, carry + *carryLength);
+        *carryLength = 0;
+        p = rowEnd;
+    }
+
+    const char* rowsEnd = lastRowEnd(p, end);
+    processRows(ws, p, rowsEnd);
+
+    if (end - rowsEnd > MAX_ROW_SIZE) {
+        fprintf(stderr, "row longer than %d bytes\n", MAX_ROW_SIZE);
+        return 1;
+    }
+    memcpy(carry, rowsEnd, end - rowsEnd);
+    *carryLength = end - rowsEnd;
+    return 0;
+}
+
+// runs the reader thread and parses its buffers as they fill, the buffers are the caller's
+static int parseStream(WeatherStation* ws, Stream* stream) {
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->changed, NULL);
+
+    enterPhase(PHASE_SCAN);
+    pthread_t reader;
+    if (pthread_create(&reader, NULL, readerThread, stream) != 0) {
+        perror("pthread_create");
+        pthread_mutex_destroy(&stream->lock);
+        pthread_cond_destroy(&stream->changed);
+        return 1;
+    }
+
+    char carry[2 * MAX_ROW_SIZE];
+    size_t carryLength = 0;
+    int failed = 0;
+
+    for (int next = 0; ; next = (next + 1) % STREAM_BUFFER_COUNT) {
+        StreamBuffer* buffer = &stream->buffers[next];
+
+        pthread_mutex_lock(&stream->lock);
+        while (!buffer->full && !stream->eof) {
+            pthread_cond_wait(&stream->changed, &stream->lock);
+        }
+        int ready = buffer->full;
+        pthread_mutex_unlock(&stream->lock);
+
+        // buffers are filled and consumed in the same order, so an empty one after eof is the end
+        if (!ready) break;
+
+        if (!failed) {
+            failed = parseStreamBuffer(ws, carry, &carryLength, buffer->data, buffer->data + buffer->length);
+        }
+
+        pthread_mutex_lock(&stream->lock);
+        buffer->full = 0;
+        pthread_cond_broadcast(&stream->changed);
+        pthread_mutex_unlock(&stream->lock);
+    }
+
+    pthread_join(reader, NULL);
+    failed |= stream->failed;
+
+    // the last row may have no trailing newline
+    if (!failed) {
+        processRows(ws, carry, carry + carryLength);
+    }
+
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->changed);
+    return failed;
+}
+
+int runStreamSource(WeatherStation* ws, const StreamSource* source) {
+    Stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.source = source;
+
+    int failed = 0;
+    for (int i = 0; i < STREAM_BUFFER_COUNT && !failed; i++) {
+        stream.buffers[i].data = (char*)malloc(IO_BUFFER_SIZE);
+        if (stream.buffers[i].data == NULL) {
+            perror("malloc failed");
+            failed = 1;
+        }
+    }
+    if (!failed) {
+        failed = parseStream(ws, &stream);
+    }
+
+    for (int i = 0; i < STREAM_BUFFER_COUNT; i++) {
+        free(stream.buffers[i].data);
+    }
+    return failed;
+}
+
+static int runStream(const IoOptions* options, WeatherStation* ws) {
+    enterPhase(PHASE_MAP);
+    FdSource fdSource;
+    // no fstat here, the size of a pipe is unknown until it ends
+    fdSource.fd = strcmp(options->path, "-") == 0 ? STDIN_FILENO : open(options->path, O_RDONLY);
+    if (fdSource.fd < 0) {
+        perror("open failed");
+        return 1;
+    }
+    // a pipe can't seek, a range on one fails here instead of parsing the wrong bytes
+    if (options->startOffset > 0 && lseek(fdSource.fd, options->startOffset, SEEK_SET) < 0) {
+        perror("lseek failed");
+        if (fdSource.fd != STDIN_FILENO) {
+            close(fdSource.fd);
+        }
+        return 1;
+    }
+    fdSource.remaining = rangeLength(options);
+
+    StreamSource source = { fillFromFd, &fdSource };
+    int failed = runStreamSource(ws, &source);
+    if (fdSource.fd != STDIN_FILENO) {
+        close(fdSource.fd);
+    }
+    return failed;
+}
+
+const IoBackend streamBackend = { "stream", runStream, 0 };
@@ -0,0 +1,20 @@
+#ifndef IO_STREAM_H
+#define IO_STREAM_H
+
+#include <sys/types.h> // ssize_t
+
+#include "io_backend.h"
+
+// where the stream backend's reader thread gets its bytes, a plain fd or a decompressor
+// fill is only called from the reader thread, it fills the buffer completely unless the input
+// ends first, returns 0 at the end and -1 after printing why it failed
+typedef struct StreamSource {
+    ssize_t (*fill)(void* state, char* buffer, size_t capacity);
+    void* state;
+} StreamSource;
+
+// the stream pipeline over any source: the reader thread fills one buffer while the calling
+// thread parses the other, returns 0 on success
+int runStreamSource(WeatherStation* ws, const StreamSource* source);
+
+#endif
@@ -0,0 +1,381 @@
+// only built with -DHAVE_LIBURING -luring, brc leaves the backend out otherwise
+#ifdef HAVE_LIBURING
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <liburing.h>
+
+#include "io_backend.h"
+#include "stats.h"
+#include "parse.h"
+
+// one ring keeps --queue-depth reads in flight over every input file, the block cursor runs
+// through the files one after the other so with many small files the reads in flight belong
+// to many files at once, the ring thread only submits and reaps and every completed buffer is
+// handed to --threads parser threads, each with its own table, merged at the end
+
+// an input file, opened when its first block is queued and closed once its last read completed
+typedef struct UringFile {
+    const char* path;
+    int fd;
+    off_t start; // the range for a single input, the whole file for a list
+    off_t end;
+    unsigned pending; // reads queued and not completed yet
+    int queuedAll;    // every block has been queued
+} UringFile;
+
+// a read covers its block plus the byte before it and MAX_ROW_SIZE after it, so rows cut by
+// the block boundary are parsed by exactly one block and blocks can complete in any order
+typedef struct UringRead {
+    UringFile* file;
+    off_t blockStart; // file offset of the block this read owns
+    off_t blockEnd;
+    off_t readStart;  // blockStart - 1, or blockStart for the first block of the file
+    size_t wanted;
+    size_t filled;    // short reads are resubmitted for the rest
+    char* buffer;
+    struct UringRead* next; // in the parse queue or the free list
+} UringRead;
+
+// completed reads wait here for a parser, parsed ones go back to the ring thread
+typedef struct ReadQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t parsable; // a read completed or the ring is done
+    pthread_cond_t freed;    // a read was parsed and its buffer can be reused
+    UringRead* parseHead;
+    UringRead* parseTail;
+    UringRead* freeList;
+    int done;
+} ReadQueue;
+
+typedef struct Parser {
+    WeatherStation ws;
+    pthread_t thread;
+    ReadQueue* queue;
+} Parser;
+
+static void* parserThread(void* arg) {
+    Parser* parser = (Parser*)arg;
+    ReadQueue* queue = parser->queue;
+
+    pthread_mutex_lock(&queue->lock);
+    while (1) {
+        while (queue->parseHead == NULL && !queue->done) {
+            pthread_cond_wait(&queue->parsable, &queue->lock);
+        }
+        UringRead* read = queue->parseHead;
+        if (read == NULL) break;
+        queue->parseHead = read->next;
+        if (queue->parseHead == NULL) queue->parseTail = NULL;
+        pthread_mutex_unlock(&queue->lock);
+
+        const char* chunk = read->buffer + (read->blockStart - read->readStart);
+        processChunkRows(&parser->ws, chunk, chunk + (read->blockEnd - read->blockStart), read->buffer + read->filled, read->blockStart == read->readStart);
+
+        pthread_mutex_lock(&queue->lock);
+        read->next = queue->freeList;
+        queue->freeList = read;
+        pthread_cond_signal(&queue->freed);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+static void queueParse(ReadQueue* queue, UringRead* read) {
+    pthread_mutex_lock(&queue->lock);
+    read->next = NULL;
+    if (queue->parseTail != NULL) {
+        queue->parseTail->next = read;
+    } else {
+        queue->parseHead = read;
+    }
+    queue->parseTail = read;
+    pthread_cond_signal(&queue->parsable);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// a buffer to read into, only waits for a parser when no read is in flight, otherwise
+// the ring thread has completions to reap and returns NULL
+static UringRead* takeFreeRead(ReadQueue* queue, int wait) {
+    pthread_mutex_lock(&queue->lock);
+    while (wait && queue->freeList == NULL) {
+        pthread_cond_wait(&queue->freed, &queue->lock);
+    }
+    UringRead* read = queue->freeList;
+    if (read != NULL) queue->freeList = read->next;
+    pthread_mutex_unlock(&queue->lock);
+    return read;
+}
+
+static void giveBackRead(ReadQueue* queue, UringRead* read) {
+    pthread_mutex_lock(&queue->lock);
+    read->next = queue->freeList;
+    queue->freeList = read;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void queueRead(struct io_uring* ring, UringRead* read) {
+    // there is always a free sqe, at most queueDepth reads are in flight
+    struct io_uring_sqe* sqe = io_uring_get_sqe(ring);
+    io_uring_prep_read(sqe, read->file->fd, read->buffer + read->filled, read->wanted - read->filled, read->readStart + read->filled);
+    io_uring_sqe_set_data(sqe, read);
+}
+
+// where the next block comes from, the file being queued and the offset in it
+typedef struct BlockCursor {
+    UringFile* files;
+    int fileCount;
+    int current;
+    off_t next;
+} BlockCursor;
+
+static int openUringFile(UringFile* file, const IoOptions* options, int single) {
+    file->fd = open(file->path, O_RDONLY);
+    if (file->fd < 0) {
+        fprintf(stderr, "open %s: %s\n", file->path, strerror(errno));
+        return 1;
+    }
+    struct stat st;
+    if (fstat(file->fd, &st) < 0) {
+        perror("fstat error");
+        close(file->fd);
+        file->fd = -1;
+        return 1;
+    }
+    file->start = single ? options->startOffset : 0;
+    file->end = single ? rangeEnd(options, st.st_size) : st.st_size;
+    return 0;
+}
+
+static void finishFileRead(UringFile* file) {
+    if (--file->pending == 0 && file->queuedAll) {
+        close(file->fd);
+        file->fd = -1;
+    }
+}
+
+// sets read up for the next block of any file, returns 1 when it did, 0 when every block is
+// queued and -1 when a file couldn't be opened
+static int nextBlock(BlockCursor* cursor, const IoOptions* options, UringRead* read) {
+    while (cursor->current < cursor->fileCount) {
+        UringFile* file = &cursor->files[cursor->current];
+        if (file->fd < 0 && !file->queuedAll) {
+            if (openUringFile(file, options, cursor->fileCount == 1) != 0) return -1;
+            cursor->next = file->start;
+        }
+        if (cursor->next < file->end) {
+            read->file = file;
+            read->blockStart = cursor->next;
+            read->blockEnd = cursor->next + IO_BUFFER_SIZE < file->end ? cursor->next + IO_BUFFER_SIZE : file->end;
+            read->readStart = read->blockStart == file->start ? read->blockStart : read->blockStart - 1;
+            off_t readEnd = read->blockEnd + MAX_ROW_SIZE < file->end ? read->blockEnd + MAX_ROW_SIZE : file->end;
+            read->wanted = readEnd - read->readStart;
+            read->filled = 0;
+            file->pending++;
+            cursor->next = read->blockEnd;
+            return 1;
+        }
+        // an empty file, or one whose reads may still be in flight
+        file->queuedAll = 1;
+        if (file->pending == 0) {
+            close(file->fd);
+            file->fd = -1;
+        }
+        cursor->current++;
+    }
+    return 0;
+}
+
+// submits and reaps until every block of every file has been read and queued for parsing,
+// stuck is left with the reads still in flight when the ring itself broke
+static int driveRing(struct io_uring* ring, unsigned depth, BlockCursor* cursor, const IoOptions* options, ReadQueue* queue, unsigned* stuck) {
+    unsigned inFlight = 0;
+    int blocksLeft = 1;
+    int failed = 0;
+    while (!failed) {
+        // top the ring up, every completion frees a slot for the next block
+        int queued = 0;
+        while (blocksLeft && inFlight < depth) {
+            UringRead* read = takeFreeRead(queue, inFlight == 0);
+            if (read == NULL) break;
+            int got = nextBlock(cursor, options, read);
+            if (got <= 0) {
+                giveBackRead(queue, read);
+                blocksLeft = 0;
+                failed = got < 0;
+                break;
+            }
+            queueRead(ring, read);
+            inFlight++;
+            queued = 1;
+        }
+        if (queued) io_uring_submit(ring);
+        if (inFlight == 0) break;
+
+        struct io_uring_cqe* cqe;
+        int ret = io_uring_wait_cqe(ring, &cqe);
+        if (ret < 0) {
+            fprintf(stderr, "io_uring_wait_cqe: %s\n", strerror(-ret));
+            *stuck = inFlight;
+            return 1;
+        }
+
+        UringRead* read = io_uring_cqe_get_data(cqe);
+        int res = cqe->res;
+        io_uring_cqe_seen(ring, cqe);
+
+        if (res == -EAGAIN) {
+            queueRead(ring, read);
+            io_uring_submit(ring);
+            continue;
+        }
+        if (res < 0) {
+            fprintf(stderr, "read %s: %s\n", read->file->path, strerror(-res));
+            failed = 1;
+            inFlight--;
+            finishFileRead(read->file);
+            break;
+        }
+
+        read->filled += res;
+        if (res > 0 && read->filled < read->wanted) {
+            queueRead(ring, read);
+            io_uring_submit(ring);
+            continue;
+        }
+        inFlight--;
+        finishFileRead(read->file);
+        queueParse(queue, read);
+    }
+
+    // a failed run still waits for its reads, the kernel writes into the buffers until then
+    while (inFlight > 0) {
+        struct io_uring_cqe* cqe;
+        if (io_uring_wait_cqe(ring, &cqe) < 0) {
+            *stuck = inFlight;
+            return 1;
+        }
+        UringRead* read = io_uring_cqe_get_data(cqe);
+        io_uring_cqe_seen(ring, cqe);
+        finishFileRead(read->file);
+        inFlight--;
+    }
+    return failed;
+}
+
+static int runUring(const IoOptions* options, WeatherStation* ws) {
+    enterPhase(PHASE_MAP);
+    int fileCount = options->pathCount > 1 ? options->pathCount : 1;
+    unsigned depth = options->queueDepth;
+    long threadCount = options->threads;
+    // every read in flight plus one being parsed by each parser
+    unsigned readCount = depth + (unsigned)threadCount;
+
+    UringFile* files = (UringFile*)calloc(fileCount, sizeof(UringFile));
+    UringRead* reads = (UringRead*)calloc(readCount, sizeof(UringRead));
+    Parser* parsers = (Parser*)calloc(threadCount, sizeof(Parser));
+    if (files == NULL || reads == NULL || parsers == NULL) {
+        perror("calloc failed");
+        free(files);
+        free(reads);
+        free(parsers);
+        return 1;
+    }
+    for (int f = 0; f < fileCount; f++) {
+        files[f].path = options->pathCount > 1 ? options->paths[f] : options->path;
+        files[f].fd = -1;
+    }
+
+    ReadQueue queue;
+    memset(&queue, 0, sizeof(queue));
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.parsable, NULL);
+    pthread_cond_init(&queue.freed, NULL);
+    int failed = 0;
+    for (unsigned i = 0; i < readCount && !failed; i++) {
+        reads[i].buffer = (char*)malloc(IO_BUFFER_SIZE + MAX_ROW_SIZE + 1);
+        if (reads[i].buffer == NULL) {
+            perror("malloc failed");
+            failed = 1;
+            break;
+        }
+        reads[i].next = queue.freeList;
+        queue.freeList = &reads[i];
+    }
+
+    struct io_uring ring;
+    int ret = failed ? 0 : io_uring_queue_init(depth, &ring, 0);
+    if (ret < 0) {
+        fprintf(stderr, "queue_init: %s\n", strerror(-ret));
+        failed = 1;
+    }
+    int ringReady = !failed;
+
+    enterPhase(PHASE_SCAN);
+    long started = 0;
+    for (long t = 0; t < threadCount && !failed; t++) {
+        parsers[t].queue = &queue;
+        initWeatherStationLike(&parsers[t].ws, ws);
+        if (pthread_create(&parsers[t].thread, NULL, parserThread, &parsers[t]) != 0) {
+            // the ones already running parse everything
+            perror("pthread_create");
+            freeWeatherStation(&parsers[t].ws);
+            failed = started == 0;
+            break;
+        }
+        started++;
+    }
+
+    unsigned stuck = 0;
+    if (!failed) {
+        BlockCursor cursor = { files, fileCount, 0, 0 };
+        failed = driveRing(&ring, depth, &cursor, options, &queue, &stuck);
+    }
+
+    pthread_mutex_lock(&queue.lock);
+    queue.done = 1;
+    pthread_cond_broadcast(&queue.parsable);
+    pthread_mutex_unlock(&queue.lock);
+    for (long t = 0; t < started; t++) {
+        pthread_join(parsers[t].thread, NULL);
+    }
+
+    enterPhase(PHASE_MERGE);
+    for (long t = 0; t < started; t++) {
+        mergeWeatherStation(ws, &parsers[t].ws);
+        freeWeatherStation(&parsers[t].ws);
+    }
+
+    if (ringReady) io_uring_queue_exit(&ring);
+    for (int f = 0; f < fileCount; f++) {
+        if (files[f].fd >= 0) close(files[f].fd);
+    }
+    // a ring that broke with reads in flight leaves their buffers to the kernel, leaked
+    if (stuck > 0) {
+        free(files);
+        free(parsers);
+        return 1;
+    }
+    for (unsigned i = 0; i < readCount; i++) {
+        free(reads[i].buffer);
+    }
+    pthread_mutex_destroy(&queue.lock);
+    pthread_cond_destroy(&queue.parsable);
+    pthread_cond_destroy(&queue.freed);
+    free(files);
+    free(reads);
+    free(parsers);
+    return failed;
+}
+
+const IoBackend uringBackend = { "uring", runUring, 1 };
+
+#endif
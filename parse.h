@@ -0,0 +1,152 @@
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <stdint.h>
+#include <string.h>
+
+// compare + movemask intrinsics, picked by -march
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "weather_station.h"
+
+// the shared parse core, every io backend hands its bytes to processRows so a
+// parser speedup reaches all of them
+
+// longest possible row: 100 byte name, ';', "-99.9" and '\n', rounded up
+#define MAX_ROW_SIZE 128
+
+// finds the first occurrence of byte in [p, end), returns end when there is none
+// compares 32 (AVX2) or 16 (SSE2) bytes per step and takes the first hit from the movemask,
+// without either it falls back to an 8 byte SWAR zero byte test
+static inline const char* findByte(const char* p, const char* end, char byte) {
+#if defined(__AVX2__)
+    __m256i needle = _mm256_set1_epi8(byte);
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+#elif defined(__SSE2__)
+    __m128i needle = _mm_set1_epi8(byte);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#else
+    uint64_t pattern = 0x0101010101010101ULL * (unsigned char)byte;
+    while (end - p >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        // matching bytes become zero, the lowest flagged zero byte is always a real match
+        uint64_t x = word ^ pattern;
+        uint64_t found = (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+        if (found) return p + (__builtin_ctzll(found) >> 3);
+        p += 8;
+    }
+#endif
+    while (p < end && *p != byte) p++;
+    return p;
+}
+
+// SWAR parse of "-99.9".."99.9" into tenths of a degree, no branches and no atof
+// reads 8 bytes from p as a little endian word, the format always has exactly one fractional digit
+// consumed gets the length up to and including the trailing '\n'
+static inline int parseTemperature(const char* p, int* consumed) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+
+    // '.' is the only byte in positions 1..3 with bit 4 clear, digits are 0x30..0x39
+    int dotPos = __builtin_ctzll(~word & 0x10101000ULL);
+    // all ones when the first byte is '-', bit 4 is clear for '-' and set for digits
+    int64_t sign = (int64_t)(~word << 59) >> 63;
+    uint64_t designMask = ~(uint64_t)(sign & 0xFF);
+    // line the digits up at bytes 1, 2 and 4 whatever the width of the number
+    uint64_t digits = ((word & designMask) << (28 - dotPos)) & 0x0F000F0F00ULL;
+    // one multiply sums 100 * tens + 10 * ones + tenths into bits 32..41
+    uint64_t absValue = ((digits * 0x640a0001ULL) >> 32) & 0x3FF;
+
+    *consumed = (dotPos >> 3) + 3;
+    return (int)((absValue ^ sign) - sign);
+}
+
+// parses the row starting at p, returns the start of the next row or NULL when there is no
+// ';' left before end, the name is [p, p + *nameLength)
+static inline const char* parseRow(const char* p, const char* end, uint32_t* nameLength, int* temp) {
+    // jump straight from the row start to its ';', the temperature parse gives the '\n'
+    const char* semicolon = findByte(p, end, ';');
+    if (semicolon == end) return NULL;
+
+    // the temperature is parsed in place, only a row at the very end of the buffer
+    // may not have 8 readable bytes left, so pad it with a copy
+    const char* tempStart = semicolon + 1;
+    int consumed;
+    if (end - tempStart >= 8)
+    {
+        *temp = parseTemperature(tempStart, &consumed);
+    }
+    else
+    {
+        char tail[8] = {0};
+        memcpy(tail, tempStart, end - tempStart);
+        *temp = parseTemperature(tail, &consumed);
+    }
+
+    *nameLength = (uint32_t)(semicolon - p);
+    return tempStart + consumed;
+}
+
+// aggregates every row in [p, end), which must start at a row start and end after a '\n'
+// (or at the end of the input, the last row may have no newline)
+static inline void processRows(WeatherStation* ws, const char* p, const char* end) {
+    COUNT_HOT(ws, bytesParsed, end - p);
+    while (p < end)
+    {
+        uint32_t nameLength;
+        int temp;
+        const char* next = parseRow(p, end, &nameLength, &temp);
+        if (next == NULL) break;
+
+        // the name is a view into the input, no copy unless the station is new
+        addStation(ws, p, nameLength, temp);
+        p = next;
+    }
+}
+
+// aggregates the rows that start inside [chunk, chunkEnd), the row crossing chunkEnd is
+// finished from the bytes up to limit and the partial row at chunk is left to the previous
+// chunk unless first is set, chunk[-1] must be readable when it isn't
+// this lets chunks be parsed in any order as long as each one is read with MAX_ROW_SIZE extra
+static inline void processChunkRows(WeatherStation* ws, const char* chunk, const char* chunkEnd, const char* limit, int first) {
+    const char* p = first ? chunk : findByte(chunk - 1, limit, '\n') + 1;
+    if (chunkEnd > limit) chunkEnd = limit;
+    if (p >= chunkEnd) return;
+
+    const char* newline = findByte(chunkEnd - 1, limit, '\n');
+    processRows(ws, p, newline < limit ? newline + 1 : limit);
+}
+
+// returns one past the last '\n' in [begin, end), or begin when the range holds no full row,
+// used by the buffered backends to keep a partial row for the next read
+static inline const char* lastRowEnd(const char* begin, const char* end) {
+    const char* p = end;
+    while (p > begin && p[-1] != '\n') p--;
+    return p;
+}
+
+// parses the complete rows of buffer[0, length) and moves the trailing partial row to the
+// front, returns its length so the next read can append right after it
+static inline size_t processBuffer(WeatherStation* ws, char* buffer, size_t length) {
+    const char* rowsEnd = lastRowEnd(buffer, buffer + length);
+    processRows(ws, buffer, rowsEnd);
+
+    size_t carry = buffer + length - rowsEnd;
+    memmove(buffer, rowsEnd, carry);
+    return carry;
+}
+
+#endif
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "weather_station.h"
+
+// dictionary stations exist before any row is read, primed so the first real row
+// sets min and max through the normal update
+static void primeRecord(TemperatureRecord* record) {
+    memset(record, 0, sizeof(*record));
+    record->minTemp = INT16_MAX;
+    record->maxTemp = INT16_MIN;
+}
+
+static uint32_t log2Ceil(uint32_t n) {
+    uint32_t shift = 1; // at least 2 entries, a shift by 32 would be undefined
+    while ((1u << shift) < n) shift++;
+    return shift;
+}
+
+static PerfectIndex* allocPerfectIndex(uint32_t bucketBits, uint32_t slotBits) {
+    PerfectIndex* perfect = (PerfectIndex*)malloc(sizeof(PerfectIndex));
+    if (perfect == NULL) {
+        perror("malloc failed");
+        exit(1);
+    }
+    perfect->bucketShift = 32 - bucketBits;
+    perfect->slotShift = 32 - slotBits;
+    perfect->size = 1 << slotBits;
+    perfect->displace = (uint32_t*)calloc((size_t)1 << bucketBits, sizeof(uint32_t));
+    perfect->slots = (StationSlot*)calloc(perfect->size, sizeof(StationSlot));
+    if (perfect->displace == NULL || perfect->slots == NULL) {
+        perror("calloc failed");
+        exit(1);
+    }
+    return perfect;
+}
+
+void freePerfectIndex(PerfectIndex* perfect) {
+    free(perfect->displace);
+    free(perfect->slots);
+    free(perfect);
+}
+
+typedef struct Bucket {
+    uint32_t index;
+    uint32_t first; // into the keys sorted by bucket
+    uint32_t size;
+} Bucket;
+
+static int cmpBucketSize(const void* a, const void* b) {
+    const Bucket* b1 = (const Bucket*)a;
+    const Bucket* b2 = (const Bucket*)b;
+    if (b1->size != b2->size) return b1->size < b2->size ? 1 : -1;
+    return b1->index < b2->index ? -1 : b1->index > b2->index;
+}
+
+static uint32_t bucketOf(const PerfectIndex* perfect, uint32_t hash) {
+    return (hash * PERFECT_BUCKET_MULTIPLIER) >> perfect->bucketShift;
+}
+
+static uint32_t slotOf(const PerfectIndex* perfect, uint32_t hash, uint32_t displace) {
+    return ((hash ^ displace) * PERFECT_SLOT_MULTIPLIER) >> perfect->slotShift;
+}
+
+// hash and displace: keys are grouped into buckets of about 4, the largest buckets are placed
+// first while the table is still empty, each bucket searches for a displacement that sends all
+// of its keys to free slots, returns 0 if some bucket found none
+// placed slots are copies of the keys, their names still point wherever the keys' do
+static int placeKeys(PerfectIndex* perfect, StationSlot** keys, uint32_t keyCount) {
+    uint32_t bucketCount = 1u << (32 - perfect->bucketShift);
+    Bucket* buckets = (Bucket*)calloc(bucketCount, sizeof(Bucket));
+    StationSlot** sorted = (StationSlot**)malloc(keyCount * sizeof(StationSlot*));
+    uint32_t* tried = (uint32_t*)malloc(keyCount * sizeof(uint32_t));
+    if (buckets == NULL || sorted == NULL || tried == NULL) {
+        perror("malloc failed");
+        exit(1);
+    }
+
+    // counting sort of the keys by bucket
+    for (uint32_t b = 0; b < bucketCount; b++) buckets[b].index = b;
+    for (uint32_t k = 0; k < keyCount; k++) buckets[bucketOf(perfect, keys[k]->hash)].size++;
+    uint32_t offset = 0;
+    for (uint32_t b = 0; b < bucketCount; b++) {
+        buckets[b].first = offset;
+        offset += buckets[b].size;
+        buckets[b].size = 0;
+    }
+    for (uint32_t k = 0; k < keyCount; k++) {
+        Bucket* bucket = &buckets[bucketOf(perfect, keys[k]->hash)];
+        sorted[bucket->first + bucket->size++] = keys[k];
+    }
+    qsort(buckets, bucketCount, sizeof(Bucket), cmpBucketSize);
+
+    int placed = 1;
+    for (uint32_t b = 0; b < bucketCount && buckets[b].size > 0 && placed; b++) {
+        Bucket* bucket = &buckets[b];
+        placed = 0;
+        for (uint32_t displace = 0; displace < (1u << 20) && !placed; displace++) {
+            uint32_t i;
+            for (i = 0; i < bucket->size; i++) {
+                uint32_t slot = slotOf(perfect, sorted[bucket->first + i]->hash, displace);
+                if (perfect->slots[slot].length != 0) break;
+                // two keys of the same bucket may also collide with each other
+                uint32_t j;
+                for (j = 0; j < i && tried[j] != slot; j++);
+                if (j < i) break;
+                tried[i] = slot;
+            }
+            if (i < bucket->size) continue;
+
+            for (i = 0; i < bucket->size; i++) {
+                perfect->slots[tried[i]] = *sorted[bucket->first + i];
+            }
+            perfect->displace[bucket->index] = displace;
+            placed = 1;
+        }
+    }
+
+    free(buckets);
+    free(sorted);
+    free(tried);
+    return placed;
+}
+
+static int cmpSlotHash(const void* a, const void* b) {
+    uint32_t h1 = (*(StationSlot* const*)a)->hash;
+    uint32_t h2 = (*(StationSlot* const*)b)->hash;
+    return h1 < h2 ? -1 : h1 > h2;
+}
+
+// keys come from a table used as a set of the dictionary names, the indexed ones are copied
+// into ws's perfect table and the rest go to its general table
+static void buildPerfectIndex(WeatherStation* ws, const WeatherStation* names) {
+    StationSlot** keys = (StationSlot**)malloc((names->count + 1) * sizeof(StationSlot*));
+    if (keys == NULL) {
+        perror("malloc failed");
+        exit(1);
+    }
+    uint32_t keyCount = 0;
+    for (int i = 0; i < names->capacity; i++) {
+        if (names->slots[i].length != 0) keys[keyCount++] = &names->slots[i];
+    }
+
+    // names sharing a full 32 bit hash can't be told apart by any displacement,
+    // only the first of them is indexed and the others stay on the general path
+    qsort(keys, keyCount, sizeof(StationSlot*), cmpSlotHash);
+    uint32_t unique = 0;
+    for (uint32_t k = 0; k < keyCount; k++) {
+        if (unique > 0 && keys[unique - 1]->hash == keys[k]->hash) {
+            primeRecord(&insertStation(ws, keys[k]->name, keys[k]->length, keys[k]->hash)->record);
+            continue;
+        }
+        keys[unique++] = keys[k];
+    }
+    keyCount = unique;
+
+    // about 4 keys per bucket and the table at most half full, grown until every bucket fits
+    uint32_t bucketBits = log2Ceil((keyCount + 3) / 4);
+    uint32_t slotBits = log2Ceil(2 * keyCount);
+    PerfectIndex* perfect;
+    while (1) {
+        perfect = allocPerfectIndex(bucketBits, slotBits);
+        if (placeKeys(perfect, keys, keyCount)) break;
+        freePerfectIndex(perfect);
+        slotBits++;
+    }
+    free(keys);
+
+    for (int i = 0; i < perfect->size; i++) {
+        StationSlot* slot = &perfect->slots[i];
+        if (slot->length == 0) continue;
+        slot->name = arenaCopyName(&ws->names, slot->name, slot->length);
+        primeRecord(&slot->record);
+    }
+    ws->perfect = perfect;
+    ws->count += keyCount;
+}
+
+int loadStationDictionary(WeatherStation* ws, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror("failed to open station dictionary");
+        return 1;
+    }
+
+    // a throwaway table as the set of names, duplicates in the file are kept once
+    WeatherStation names;
+    initWeatherStation(&names, STATION_TABLE_CAPACITY);
+
+    char* line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &lineCapacity, file)) != -1) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+        if (length == 0) continue;
+
+        uint32_t hash = hashName(line, (uint32_t)length);
+        if (findStation(&names, line, hash, (uint32_t)length)->length == 0) {
+            insertStation(&names, line, (uint32_t)length, hash);
+        }
+    }
+    free(line);
+    fclose(file);
+
+    if (names.count == 0) {
+        fprintf(stderr, "station dictionary %s is empty\n", path);
+        freeWeatherStation(&names);
+        return 1;
+    }
+    buildPerfectIndex(ws, &names);
+    freeWeatherStation(&names);
+    return 0;
+}
+
+void clonePerfectIndex(WeatherStation* dst, const WeatherStation* src) {
+    const PerfectIndex* from = src->perfect;
+    uint32_t bucketBits = 32 - from->bucketShift;
+
+    PerfectIndex* perfect = allocPerfectIndex(bucketBits, 32 - from->slotShift);
+    memcpy(perfect->displace, from->displace, ((size_t)1 << bucketBits) * sizeof(uint32_t));
+    for (int i = 0; i < from->size; i++) {
+        const StationSlot* slot = &from->slots[i];
+        if (slot->length == 0) continue;
+        perfect->slots[i] = *slot;
+        perfect->slots[i].name = arenaCopyName(&dst->names, slot->name, slot->length);
+        primeRecord(&perfect->slots[i].record);
+        dst->count++;
+    }
+    dst->perfect = perfect;
+
+    // dictionary names that share a hash live in the general table, dst knows them too
+    for (int i = 0; i < src->capacity; i++) {
+        const StationSlot* slot = &src->slots[i];
+        if (slot->length == 0) continue;
+        primeRecord(&insertStation(dst, slot->name, slot->length, slot->hash)->record);
+    }
+}
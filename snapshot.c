@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h> // pread
+#include <sys/stat.h>
+
+#include "snapshot.h"
+#include "parse.h"
+#include "stats.h"
+
+int writeWeatherStation(FILE* out, const WeatherStation* ws) {
+    uint32_t count = 0;
+    int slotCount = stationSlotCount(ws);
+    for (int i = 0; i < slotCount; i++) {
+        const StationSlot* slot = stationSlotAt(ws, i);
+        if (slot->length != 0 && slot->record.numRecords != 0) count++;
+    }
+    if (fwrite(&count, sizeof(count), 1, out) != 1) return 1;
+
+    for (int i = 0; i < slotCount; i++) {
+        const StationSlot* slot = stationSlotAt(ws, i);
+        if (slot->length == 0 || slot->record.numRecords == 0) continue;
+        const TemperatureRecord* record = &slot->record;
+        if (fwrite(&slot->length, sizeof(slot->length), 1, out) != 1 ||
+            fwrite(slot->name, 1, slot->length, out) != slot->length ||
+            fwrite(&record->minTemp, sizeof(record->minTemp), 1, out) != 1 ||
+            fwrite(&record->maxTemp, sizeof(record->maxTemp), 1, out) != 1 ||
+            fwrite(&record->numRecords, sizeof(record->numRecords), 1, out) != 1 ||
+            fwrite(&record->totalTemp, sizeof(record->totalTemp), 1, out) != 1) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int readWeatherStation(FILE* in, WeatherStation* ws) {
+    uint32_t count;
+    if (fread(&count, sizeof(count), 1, in) != 1) return 1;
+
+    char name[MAX_ROW_SIZE];
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t length;
+        TemperatureRecord record;
+        if (fread(&length, sizeof(length), 1, in) != 1 || length == 0 || length > MAX_ROW_SIZE) return 1;
+        if (fread(name, 1, length, in) != length ||
+            fread(&record.minTemp, sizeof(record.minTemp), 1, in) != 1 ||
+            fread(&record.maxTemp, sizeof(record.maxTemp), 1, in) != 1 ||
+            fread(&record.numRecords, sizeof(record.numRecords), 1, in) != 1 ||
+            fread(&record.totalTemp, sizeof(record.totalTemp), 1, in) != 1) {
+            return 1;
+        }
+        mergeStation(ws, name, length, hashName(name, length), &record);
+    }
+    return 0;
+}
+
+// reads exactly length bytes at offset, returns 0 on success
+static int readAt(int fd, char* buffer, size_t length, off_t offset) {
+    size_t filled = 0;
+    while (filled < length) {
+        ssize_t bytesRead = pread(fd, buffer + filled, length - filled, offset + filled);
+        if (bytesRead <= 0) return 1;
+        filled += bytesRead;
+    }
+    return 0;
+}
+
+// FNV-1a over the block before offset, a rewrite that keeps the inode and grows past the
+// old offset is caught here unless it reproduces those bytes exactly
+static int checksumBefore(int fd, off_t offset, uint64_t* checksum) {
+    char block[SNAPSHOT_CHECK_SIZE];
+    off_t start = offset > SNAPSHOT_CHECK_SIZE ? offset - SNAPSHOT_CHECK_SIZE : 0;
+    if (readAt(fd, block, offset - start, start) != 0) return 1;
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (off_t i = 0; i < offset - start; i++) {
+        hash ^= (unsigned char)block[i];
+        hash *= 1099511628211ULL;
+    }
+    *checksum = hash;
+    return 0;
+}
+
+// one past the last '\n', the row after it may still be half written by the appender
+static off_t completeRowsEnd(int fd, off_t size) {
+    char block[SNAPSHOT_CHECK_SIZE];
+    off_t start = size > SNAPSHOT_CHECK_SIZE ? size - SNAPSHOT_CHECK_SIZE : 0;
+    if (readAt(fd, block, size - start, start) != 0) return -1;
+    return start + (lastRowEnd(block, block + (size - start)) - block);
+}
+
+// reads the snapshot into loaded when its mark still describes the input, returns 0 if so
+static int loadSnapshot(const char* snapshotPath, int fd, const struct stat* st, WeatherStation* loaded, SnapshotMark* mark) {
+    FILE* in = fopen(snapshotPath, "rb");
+    if (in == NULL) {
+        if (errno == ENOENT) {
+            fprintf(stderr, "snapshot: no %s yet, full scan\n", snapshotPath);
+        } else {
+            perror("snapshot: fopen failed, full scan");
+        }
+        return 1;
+    }
+
+    char magic[sizeof(SNAPSHOT_MAGIC) - 1];
+    if (fread(magic, sizeof(magic), 1, in) != 1 || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 ||
+        fread(mark, sizeof(*mark), 1, in) != 1) {
+        fprintf(stderr, "snapshot: %s is not a snapshot, full scan\n", snapshotPath);
+        fclose(in);
+        return 1;
+    }
+
+    uint64_t checksum;
+    if (mark->device != (uint64_t)st->st_dev || mark->inode != (uint64_t)st->st_ino ||
+        mark->offset > (uint64_t)st->st_size || checksumBefore(fd, mark->offset, &checksum) != 0 ||
+        checksum != mark->checksum) {
+        fprintf(stderr, "snapshot: input was replaced or rewritten since %s, full scan\n", snapshotPath);
+        fclose(in);
+        return 1;
+    }
+
+    if (readWeatherStation(in, loaded) != 0) {
+        fprintf(stderr, "snapshot: %s is truncated, full scan\n", snapshotPath);
+        fclose(in);
+        return 1;
+    }
+    fclose(in);
+    return 0;
+}
+
+// written next to the target and renamed over it, a crash never leaves half a snapshot
+static int saveSnapshot(const char* snapshotPath, const WeatherStation* ws, const SnapshotMark* mark) {
+    size_t pathLength = strlen(snapshotPath);
+    char* tmpPath = (char*)malloc(pathLength + 5);
+    if (tmpPath == NULL) {
+        perror("malloc failed");
+        return 1;
+    }
+    memcpy(tmpPath, snapshotPath, pathLength);
+    memcpy(tmpPath + pathLength, ".tmp", 5);
+
+    FILE* out = fopen(tmpPath, "wb");
+    if (out == NULL) {
+        perror("snapshot: fopen failed");
+        free(tmpPath);
+        return 1;
+    }
+    int failed = fwrite(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC) - 1, 1, out) != 1 ||
+                 fwrite(mark, sizeof(*mark), 1, out) != 1 ||
+                 writeWeatherStation(out, ws) != 0;
+    failed |= fclose(out) != 0;
+    if (!failed && rename(tmpPath, snapshotPath) != 0) {
+        failed = 1;
+    }
+    if (failed) {
+        perror("snapshot: write failed");
+        unlink(tmpPath);
+    }
+    free(tmpPath);
+    return failed;
+}
+
+int runWithSnapshot(const IoBackend* backend, const IoOptions* options, WeatherStation* ws, const char* snapshotPath) {
+    int fd = open(options->path, O_RDONLY);
+    if (fd < 0) {
+        perror("open failed");
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror("fstat error");
+        close(fd);
+        return 1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        fprintf(stderr, "snapshot: %s is not a regular file\n", options->path);
+        close(fd);
+        return 1;
+    }
+
+    off_t end = completeRowsEnd(fd, st.st_size);
+    if (end < 0) {
+        perror("snapshot: read failed");
+        close(fd);
+        return 1;
+    }
+
+    IoOptions range = *options;
+    range.startOffset = 0;
+    range.endOffset = end;
+
+    WeatherStation loaded;
+    SnapshotMark mark;
+    initWeatherStation(&loaded, STATION_TABLE_CAPACITY);
+    if (loadSnapshot(snapshotPath, fd, &st, &loaded, &mark) == 0) {
+        mergeWeatherStation(ws, &loaded);
+        range.startOffset = mark.offset;
+        fprintf(stderr, "snapshot: resuming at byte %llu, %lld new bytes\n",
+            (unsigned long long)mark.offset, (long long)(end - range.startOffset));
+    }
+    freeWeatherStation(&loaded);
+
+    // endOffset 0 would mean the whole file, an empty range skips the backend instead
+    if (end > range.startOffset && backend->run(&range, ws) != 0) {
+        close(fd);
+        return 1;
+    }
+
+    enterPhase(PHASE_SETUP);
+    mark.device = st.st_dev;
+    mark.inode = st.st_ino;
+    mark.offset = end;
+    int failed = checksumBefore(fd, end, &mark.checksum) != 0 || saveSnapshot(snapshotPath, ws, &mark) != 0;
+
+    // the bytes after end, a row the appender may still be writing, are left out of this run
+    // and parsed from the snapshot's offset by the first run that sees them complete
+    close(fd);
+    return failed;
+}
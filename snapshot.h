@@ -0,0 +1,34 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "io_backend.h"
+
+// an append only input only needs its new bytes parsed, a snapshot keeps the aggregated
+// table together with how far into the input it got and enough of the input's identity
+// to tell an append from a rewrite
+
+// where a snapshot stopped and what the input looked like there
+typedef struct SnapshotMark {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t offset;   // bytes aggregated, always just past a '\n'
+    uint64_t checksum; // FNV-1a over the SNAPSHOT_CHECK_SIZE bytes before offset
+} SnapshotMark;
+
+#define SNAPSHOT_MAGIC "BRCSNAP1"
+#define SNAPSHOT_CHECK_SIZE 4096
+
+// the table as a count and then one (length, name, record) entry per station that has rows,
+// in host byte order, a reader folds the entries into its own table, returns 0 on success
+int writeWeatherStation(FILE* out, const WeatherStation* ws);
+int readWeatherStation(FILE* in, WeatherStation* ws);
+
+// aggregates options->path with backend, starting from the snapshot at snapshotPath when it
+// still matches the input and doing a full scan otherwise, then saves a snapshot of the new
+// end, a trailing row without its '\n' is left out of both until a run sees it complete
+int runWithSnapshot(const IoBackend* backend, const IoOptions* options, WeatherStation* ws, const char* snapshotPath);
+
+#endif
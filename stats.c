@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h> // NAN, isnan, isfinite
+#include <time.h>
+
+#include <unistd.h> // syscall, read, close
+#include <sys/ioctl.h>
+#include <sys/syscall.h> // __NR_perf_event_open, glibc has no wrapper
+#include <sys/time.h> // timeradd
+#include <sys/resource.h> // getrusage
+#include <linux/perf_event.h>
+
+#include "stats.h"
+
+static const char* const phaseNames[PHASE_COUNT] = { "setup", "map", "scan", "merge", "sort", "print" };
+
+static double phaseTotals[PHASE_COUNT];
+static int currentPhase = -1;
+static struct timespec phaseStart;
+
+static void enablePerfCounters(int enable);
+static void printPerfSection(const PerfReport* perf, int json);
+
+void enterPhase(Phase phase) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (currentPhase >= 0) {
+        phaseTotals[currentPhase] += (now.tv_sec - phaseStart.tv_sec) + (now.tv_nsec - phaseStart.tv_nsec) / 1e9;
+    }
+    if (currentPhase == PHASE_SCAN && phase != PHASE_SCAN) enablePerfCounters(0);
+    if (currentPhase != PHASE_SCAN && phase == PHASE_SCAN) enablePerfCounters(1);
+    currentPhase = phase;
+    phaseStart = now;
+}
+
+void endPhases(void) {
+    enterPhase(PHASE_SETUP);
+    currentPhase = -1;
+}
+
+typedef struct StatLine {
+    const char* name;
+    double value;
+    const char* format;
+} StatLine;
+
+static void printSection(const char* title, const StatLine* lines, int count, int json, int last) {
+    if (json) {
+        fprintf(stderr, "  \"%s\": {", title);
+        for (int i = 0; i < count; i++) {
+            fprintf(stderr, "%s\"%s\": ", i ? ", " : "", lines[i].name);
+            fprintf(stderr, lines[i].format, lines[i].value);
+        }
+        fprintf(stderr, "}%s\n", last ? "" : ",");
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        fprintf(stderr, "%-8s %-22s ", title, lines[i].name);
+        fprintf(stderr, lines[i].format, lines[i].value);
+        fprintf(stderr, "\n");
+    }
+}
+
+void readProcessUsage(struct rusage* usage) {
+    struct rusage children;
+    getrusage(RUSAGE_SELF, usage);
+    getrusage(RUSAGE_CHILDREN, &children);
+    if (children.ru_maxrss > usage->ru_maxrss) usage->ru_maxrss = children.ru_maxrss;
+    usage->ru_minflt += children.ru_minflt;
+    usage->ru_majflt += children.ru_majflt;
+    usage->ru_nvcsw += children.ru_nvcsw;
+    usage->ru_nivcsw += children.ru_nivcsw;
+    timeradd(&usage->ru_utime, &children.ru_utime, &usage->ru_utime);
+    timeradd(&usage->ru_stime, &children.ru_stime, &usage->ru_stime);
+}
+
+void printStatsReport(const WeatherStation* ws, const PerfReport* perf, int json) {
+    StatLine phases[PHASE_COUNT + 1];
+    double total = 0;
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        phases[i] = (StatLine){ phaseNames[i], phaseTotals[i], "%.6f" };
+        total += phaseTotals[i];
+    }
+    phases[PHASE_COUNT] = (StatLine){ "total", total, "%.6f" };
+
+    // ru_maxrss is in KB on linux
+    struct rusage usage;
+    readProcessUsage(&usage);
+    StatLine process[] = {
+        { "peak_rss_kb", (double)usage.ru_maxrss, "%.0f" },
+        { "minor_faults", (double)usage.ru_minflt, "%.0f" },
+        { "major_faults", (double)usage.ru_majflt, "%.0f" },
+        { "voluntary_switches", (double)usage.ru_nvcsw, "%.0f" },
+        { "involuntary_switches", (double)usage.ru_nivcsw, "%.0f" },
+        { "user_s", usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6, "%.6f" },
+        { "sys_s", usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6, "%.6f" },
+    };
+
+    if (json) fprintf(stderr, "{\n");
+    printSection("phase_s", phases, PHASE_COUNT + 1, json, 0);
+#ifdef BRC_STATS
+    StatLine counters[] = {
+        { "rows", (double)ws->counters.rows, "%.0f" },
+        { "bytes_parsed", (double)ws->counters.bytesParsed, "%.0f" },
+        { "new_stations", (double)ws->counters.newStations, "%.0f" },
+        { "probes", (double)ws->counters.probes, "%.0f" },
+        { "collisions", (double)ws->counters.collisions, "%.0f" },
+        { "perfect_hits", (double)ws->counters.perfectHits, "%.0f" },
+    };
+    printSection("counters", counters, sizeof(counters) / sizeof(counters[0]), json, 0);
+#else
+    (void)ws;
+    if (!json) fprintf(stderr, "counters: build with -DBRC_STATS for the hot path counters\n");
+#endif
+    printSection("process", process, sizeof(process) / sizeof(process[0]), json, perf == NULL);
+    if (perf != NULL) printPerfSection(perf, json);
+    if (json) fprintf(stderr, "}\n");
+}
+
+const char* const perfEventNames[PERF_EVENT_COUNT] = {
+    "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses", "dtlb_misses", "task_clock_ns"
+};
+
+typedef struct PerfEventType {
+    uint32_t type;
+    uint64_t config;
+    int group; // events of a group are opened under the group's first event that opened
+} PerfEventType;
+
+#define CACHE_READ_MISS(cache) ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const PerfEventType perfEventTypes[PERF_EVENT_COUNT] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 0 },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 0 },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, 0 },
+    { PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D), 1 },
+    { PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL), 1 },
+    { PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB), 1 },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, 2 },
+};
+
+#define PERF_GROUP_COUNT 3
+
+// why counters are missing, for the JSON report when openPerfCounters was quiet
+static char perfUnavailable[160];
+
+static int perfFds[PERF_EVENT_COUNT] = { -1, -1, -1, -1, -1, -1, -1 };
+static int perfLeaders[PERF_GROUP_COUNT] = { -1, -1, -1 };
+
+static int perfEventOpen(const PerfEventType* type, int groupFd, int excludeKernel) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type->type;
+    attr.config = type->config;
+    // members follow the leader, only the leader starts disabled
+    attr.disabled = groupFd < 0;
+    attr.inherit = 1; // counts the worker threads created after this
+    attr.exclude_kernel = excludeKernel;
+    attr.exclude_hv = 1;
+    // not PERF_FORMAT_GROUP, inherited counters can't be read as a group, each fd is read on its own
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+int openPerfCounters(int quiet) {
+    int opened = 0;
+    int firstError = 0;
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        int group = perfEventTypes[i].group;
+        int fd = perfEventOpen(&perfEventTypes[i], perfLeaders[group], 0);
+        // perf_event_paranoid 2 only allows user space counting
+        if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+            fd = perfEventOpen(&perfEventTypes[i], perfLeaders[group], 1);
+        }
+        if (fd < 0) {
+            if (firstError == 0) firstError = errno;
+            continue;
+        }
+        perfFds[i] = fd;
+        if (perfLeaders[group] < 0) perfLeaders[group] = fd;
+        opened++;
+    }
+
+    perfUnavailable[0] = '\0';
+    if (opened < PERF_EVENT_COUNT) {
+        snprintf(perfUnavailable, sizeof(perfUnavailable), "%d of %d counters unavailable (%s), %s", PERF_EVENT_COUNT - opened,
+            PERF_EVENT_COUNT, strerror(firstError), firstError == ENOENT || firstError == EOPNOTSUPP ?
+            "no hardware pmu, a vm or container without one" : "lower kernel.perf_event_paranoid or grant CAP_PERFMON");
+    }
+
+    // bench opens them for every run, say why only once
+    static int warned = 0;
+    if (perfUnavailable[0] != '\0' && !quiet && !warned) {
+        warned = 1;
+        fprintf(stderr, "perf: %s\n", perfUnavailable);
+    }
+    return opened;
+}
+
+static void enablePerfCounters(int enable) {
+    for (int g = 0; g < PERF_GROUP_COUNT; g++) {
+        if (perfLeaders[g] < 0) continue;
+        ioctl(perfLeaders[g], enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void readPerfCounters(double values[PERF_EVENT_COUNT]) {
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        values[i] = NAN;
+        uint64_t data[3]; // value, time enabled, time running
+        if (perfFds[i] < 0 || read(perfFds[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) continue;
+        values[i] = data[2] < data[1] ? (double)data[0] * data[1] / data[2] : (double)data[0];
+    }
+}
+
+void closePerfCounters(void) {
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (perfFds[i] >= 0) close(perfFds[i]);
+        perfFds[i] = -1;
+    }
+    for (int g = 0; g < PERF_GROUP_COUNT; g++) perfLeaders[g] = -1;
+}
+
+// a JSON number, or null for nan and inf, which JSON has no spelling for
+static void printJsonNumber(const char* format, double value) {
+    if (isfinite(value)) fprintf(stderr, format, value);
+    else fprintf(stderr, "null");
+}
+
+// the "perf" member of the report object, or the perf lines of the table
+static void printPerfSection(const PerfReport* perf, int json) {
+    const double* values = perf->values;
+    double ipc = values[PERF_INSTRUCTIONS] / values[PERF_CYCLES];
+    if (json) {
+        fprintf(stderr, "  \"perf\": {");
+        for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+            if (isnan(values[i])) {
+                fprintf(stderr, "\"%s\": null, ", perfEventNames[i]);
+                continue;
+            }
+            fprintf(stderr, "\"%s\": {\"total\": %.0f, \"per_row\": ", perfEventNames[i], values[i]);
+            printJsonNumber("%.6f", values[i] / perf->rows);
+            fprintf(stderr, ", \"per_byte\": ");
+            printJsonNumber("%.6f", values[i] / perf->bytes);
+            fprintf(stderr, "}, ");
+        }
+        if (perfUnavailable[0] != '\0') fprintf(stderr, "\"unavailable\": \"%s\", ", perfUnavailable);
+        fprintf(stderr, "\"ipc\": ");
+        printJsonNumber("%.3f", ipc);
+        fprintf(stderr, "}\n");
+        return;
+    }
+
+    // a column that can't be computed (no rows, no size) is left out rather than shown as inf or nan
+    int perRow = isfinite(1.0 / perf->rows) && perf->rows != 0;
+    int perByte = isfinite(1.0 / perf->bytes) && perf->bytes != 0;
+    fprintf(stderr, "%-8s %-22s %16s", "perf", "event", "total");
+    if (perRow) fprintf(stderr, " %12s", "per_row");
+    if (perByte) fprintf(stderr, " %12s", "per_byte");
+    fprintf(stderr, "\n");
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (isnan(values[i])) {
+            fprintf(stderr, "%-8s %-22s %16s\n", "perf", perfEventNames[i], "n/a");
+            continue;
+        }
+        fprintf(stderr, "%-8s %-22s %16.0f", "perf", perfEventNames[i], values[i]);
+        if (perRow) fprintf(stderr, " %12.4f", values[i] / perf->rows);
+        if (perByte) fprintf(stderr, " %12.4f", values[i] / perf->bytes);
+        fprintf(stderr, "\n");
+    }
+    if (isfinite(ipc)) fprintf(stderr, "%-8s %-22s %16.3f\n", "perf", "ipc", ipc);
+}
+
+void printPerfReport(const PerfReport* perf) {
+    printPerfSection(perf, 0);
+}
@@ -0,0 +1,73 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <sys/resource.h> // struct rusage
+
+#include "weather_station.h"
+
+// where a run's wall time goes, the main thread switches from one phase to the next and the
+// time between two switches is charged to the phase that was running, a few clock reads per run
+typedef enum Phase {
+    PHASE_SETUP, // options, dictionary, snapshot
+    PHASE_MAP,   // open, fstat, mmap or buffers, and unmapping at the end
+    PHASE_SCAN,  // parse and aggregate, for threaded backends until the last thread joins
+    PHASE_MERGE, // folding the per thread tables into one
+    PHASE_SORT,
+    PHASE_PRINT,
+    PHASE_COUNT
+} Phase;
+
+// ends the running phase, if any, and starts phase, the perf counters below only run
+// while the phase is PHASE_SCAN
+void enterPhase(Phase phase);
+// ends the running phase without starting another
+void endPhases(void);
+
+// getrusage of this process plus its reaped children, the --fork worker, peak RSS is the
+// larger of the two
+void readProcessUsage(struct rusage* usage);
+
+// hardware counters read by the process itself with perf_event_open, for hosts where perf
+// can't be run, opened as two groups so each set is scheduled onto the pmu together and
+// inherited by the threads a backend starts, user and kernel space unless perf_event_paranoid
+// only allows user space, task-clock is a software event and works even without a pmu
+typedef enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_TASK_CLOCK, // ns of cpu time across every thread
+    PERF_EVENT_COUNT
+} PerfEvent;
+
+extern const char* const perfEventNames[PERF_EVENT_COUNT];
+
+// opens every event it can, they stay stopped until the next scan phase and collect over
+// every scan until closed, must be called before the threads to count are created
+// says on stderr why an event is missing, or with quiet only in the JSON report, and returns
+// how many were opened
+int openPerfCounters(int quiet);
+// the totals so far scaled up for the time an event was multiplexed off the pmu,
+// NAN for an event that couldn't be opened or never ran
+void readPerfCounters(double values[PERF_EVENT_COUNT]);
+void closePerfCounters(void);
+// the --perf totals of a run and what they are divided by, rows is 0 and bytes NAN when they
+// aren't known (stdin has no size), a per row or per byte value that isn't finite is null in
+// JSON and its column is left out of the table
+typedef struct PerfReport {
+    double values[PERF_EVENT_COUNT];
+    double rows;
+    double bytes;
+} PerfReport;
+
+// values per row and per byte, plus ipc, to stderr as a table
+void printPerfReport(const PerfReport* perf);
+
+// phase times, the hot path counters of ws when built with -DBRC_STATS, the process's peak RSS,
+// page faults and context switches, and perf unless it is NULL, to stderr as an aligned table
+// or one JSON object with perf nested in it
+void printStatsReport(const WeatherStation* ws, const PerfReport* perf, int json);
+
+#endif
@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <sys/mman.h> // madvise
+
+#include "weather_station.h"
+
+static char* arenaAlloc(NameArena* arena, size_t size) {
+    ArenaBlock* block = arena->head;
+    if (block == NULL || block->used + size > block->capacity) {
+        // the rare slow path, one malloc per block instead of one per name
+        size_t capacity = size > NAME_ARENA_BLOCK_SIZE ? size : NAME_ARENA_BLOCK_SIZE;
+        block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + capacity);
+        if (block == NULL) {
+            perror("malloc failed");
+            exit(1);
+        }
+        block->next = arena->head;
+        block->used = 0;
+        block->capacity = capacity;
+        arena->head = block;
+    }
+
+    char* ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+static void arenaFree(NameArena* arena) {
+    ArenaBlock* block = arena->head;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+}
+
+char* arenaCopyName(NameArena* arena, const char* name, uint32_t length) {
+    size_t size = (length + NAME_PAD) & ~(size_t)(NAME_PAD - 1);
+    char* copy = arenaAlloc(arena, size);
+    memcpy(copy, name, length);
+    memset(copy + length, 0, size - length);
+    return copy;
+}
+
+// table slab aligned to a cache line, so a 32 byte slot never straddles two lines
+static void* allocSlab(size_t count, size_t size) {
+    size_t bytes = count * size;
+    void* slab = aligned_alloc(64, (bytes + 63) & ~(size_t)63);
+    if (slab == NULL) {
+        perror("aligned_alloc failed");
+        exit(1);
+    }
+    memset(slab, 0, bytes);
+    return slab;
+}
+
+static uint32_t** allocHistogramIndex(const WeatherStation* ws) {
+    uint32_t** histograms = (uint32_t**)calloc(stationSlotCount(ws), sizeof(uint32_t*));
+    if (histograms == NULL) {
+        perror("calloc failed");
+        exit(1);
+    }
+    return histograms;
+}
+
+// only hit when there are far more stations than the table was sized for
+static void growWeatherStation(WeatherStation* ws) {
+    StationSlot* oldSlots = ws->slots;
+    int oldCapacity = ws->capacity;
+    uint32_t** oldHistograms = ws->histograms;
+
+    ws->capacity = oldCapacity * 2;
+    ws->slots = (StationSlot*)allocSlab(ws->capacity, sizeof(StationSlot));
+    // slots move and the dictionary's indexes start after the new capacity
+    if (oldHistograms != NULL) {
+        ws->histograms = allocHistogramIndex(ws);
+        for (int i = 0; ws->perfect != NULL && i < ws->perfect->size; i++) {
+            ws->histograms[ws->capacity + i] = oldHistograms[oldCapacity + i];
+        }
+    }
+    for (int i = 0; i < oldCapacity; i++) {
+        if (oldSlots[i].length == 0) continue;
+        StationSlot* slot = findStation(ws, oldSlots[i].name, oldSlots[i].hash, oldSlots[i].length);
+        *slot = oldSlots[i];
+        if (oldHistograms != NULL) {
+            ws->histograms[slot - ws->slots] = oldHistograms[i];
+        }
+    }
+    free(oldSlots);
+    free(oldHistograms);
+}
+
+void initWeatherStation(WeatherStation* ws, int capacity) {
+    // round up to a power of two so probing can mask instead of mod
+    int size = 1;
+    while (size < capacity) size <<= 1;
+
+    ws->slots = (StationSlot*)allocSlab(size, sizeof(StationSlot));
+    ws->capacity = size;
+    ws->count = 0;
+    ws->names.head = NULL;
+    ws->perfect = NULL;
+    ws->histograms = NULL;
+    ws->histogramArena.head = NULL;
+#ifdef BRC_STATS
+    memset(&ws->counters, 0, sizeof(ws->counters));
+#endif
+}
+
+void initWeatherStationLike(WeatherStation* ws, const WeatherStation* main) {
+    initWeatherStation(ws, main->capacity);
+    if (main->perfect != NULL) {
+        clonePerfectIndex(ws, main);
+    }
+    if (main->histograms != NULL) {
+        enablePercentiles(ws);
+    }
+}
+
+void enablePercentiles(WeatherStation* ws) {
+    ws->histograms = allocHistogramIndex(ws);
+}
+
+uint32_t* allocHistogram(WeatherStation* ws, int index) {
+    // whole cache lines, so no two histograms share one
+    size_t size = (HISTOGRAM_BUCKETS * sizeof(uint32_t) + 63) & ~(size_t)63;
+    NameArena* arena = &ws->histogramArena;
+    ArenaBlock* block = arena->head;
+    if (block == NULL || block->used + size > block->capacity) {
+        // aligned so the kernel can back the block with one huge page, the advice is only a hint
+        block = (ArenaBlock*)aligned_alloc(HISTOGRAM_BLOCK_SIZE, HISTOGRAM_BLOCK_SIZE);
+        if (block == NULL) {
+            perror("aligned_alloc failed");
+            exit(1);
+        }
+        madvise(block, HISTOGRAM_BLOCK_SIZE, MADV_HUGEPAGE);
+        memset(block, 0, HISTOGRAM_BLOCK_SIZE);
+        block->next = arena->head;
+        block->capacity = HISTOGRAM_BLOCK_SIZE - sizeof(ArenaBlock);
+        // histograms start on a cache line
+        block->used = 64 - sizeof(ArenaBlock);
+        arena->head = block;
+    }
+
+    uint32_t* histogram = (uint32_t*)(block->data + block->used);
+    block->used += size;
+    ws->histograms[index] = histogram;
+    return histogram;
+}
+
+void freeWeatherStation(WeatherStation* ws) {
+    // names all live in the arena, no per station free
+    arenaFree(&ws->names);
+    if (ws->histograms != NULL) {
+        arenaFree(&ws->histogramArena);
+        free(ws->histograms);
+        ws->histograms = NULL;
+    }
+    free(ws->slots);
+    if (ws->perfect != NULL) {
+        freePerfectIndex(ws->perfect);
+        ws->perfect = NULL;
+    }
+}
+
+StationSlot* insertStation(WeatherStation* ws, const char* name, uint32_t length, uint32_t hash) {
+    // keep the load factor under 1/2 so probe chains stay short
+    if (2 * (ws->count + 1) > ws->capacity) {
+        growWeatherStation(ws);
+    }
+
+    StationSlot* slot = findStation(ws, name, hash, length);
+
+    // no allocator call here, the name is bumped into the arena
+    slot->name = arenaCopyName(&ws->names, name, length);
+    slot->hash = hash;
+    slot->length = length;
+    memset(&slot->record, 0, sizeof(slot->record));
+    ws->count++;
+    COUNT_HOT(ws, newStations, 1);
+    return slot;
+}
+
+StationSlot* mergeStation(WeatherStation* dst, const char* name, uint32_t length, uint32_t hash, const TemperatureRecord* record) {
+    StationSlot* slot = lookupStation(dst, name, hash, length);
+    if (slot->length == 0) {
+        slot = insertStation(dst, name, length, hash);
+        slot->record = *record;
+    } else {
+        TemperatureRecord* existingRecord = &slot->record;
+        existingRecord->minTemp = existingRecord->minTemp < record->minTemp ? existingRecord->minTemp : record->minTemp;
+        existingRecord->maxTemp = existingRecord->maxTemp > record->maxTemp ? existingRecord->maxTemp : record->maxTemp;
+        existingRecord->totalTemp += record->totalTemp;
+        existingRecord->numRecords += record->numRecords;
+    }
+    return slot;
+}
+
+void mergeWeatherStation(WeatherStation* dst, const WeatherStation* src) {
+    int slotCount = stationSlotCount(src);
+    for (int i = 0; i < slotCount; i++) {
+        const StationSlot* from = stationSlotAt(src, i);
+        // dictionary stations that never showed up have no rows to merge
+        if (from->length == 0 || from->record.numRecords == 0) continue;
+        StationSlot* to = mergeStation(dst, from->name, from->length, from->hash, &from->record);
+        if (src->histograms != NULL && src->histograms[i] != NULL) {
+            uint32_t* histogram = stationHistogram(dst, to);
+            for (int b = 0; b < HISTOGRAM_BUCKETS; b++) histogram[b] += src->histograms[i][b];
+        }
+    }
+
+#ifdef BRC_STATS
+    // after the loop, the lookups above count towards dst like any other
+    dst->counters.rows += src->counters.rows;
+    dst->counters.bytesParsed += src->counters.bytesParsed;
+    dst->counters.newStations += src->counters.newStations;
+    dst->counters.probes += src->counters.probes;
+    dst->counters.collisions += src->counters.collisions;
+    dst->counters.perfectHits += src->counters.perfectHits;
+#endif
+}
+
+uint64_t countRecords(const WeatherStation* ws) {
+    uint64_t rows = 0;
+    int slotCount = stationSlotCount(ws);
+    for (int i = 0; i < slotCount; i++) {
+        rows += stationSlotAt(ws, i)->record.numRecords;
+    }
+    return rows;
+}
+
+// nearest rank: the smallest temperature with at least percent% of the rows at or below it
+static double histogramPercentile(const uint32_t* histogram, uint32_t count, int percent) {
+    uint64_t rank = ((uint64_t)count * percent + 99) / 100;
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    int bucket = 0;
+    while (bucket < HISTOGRAM_BUCKETS - 1 && (seen += histogram[bucket]) < rank) bucket++;
+    return (bucket - HISTOGRAM_OFFSET) / 10.0;
+}
+
+static int cmpStationName(const void* a, const void* b) {
+    const NamedRecord* s1 = (const NamedRecord*)a;
+    const NamedRecord* s2 = (const NamedRecord*)b;
+    return strcmp(s1->name, s2->name); // lexographic order
+}
+
+NamedRecord* sortStations(const WeatherStation* ws, int* count) {
+    NamedRecord* sortArray = (NamedRecord*)calloc(ws->count, sizeof(NamedRecord));
+    int sortCount = 0;
+    int slotCount = stationSlotCount(ws);
+    for (int i = 0; i < slotCount; i++) {
+        StationSlot* slot = stationSlotAt(ws, i);
+        if (slot->length == 0 || slot->record.numRecords == 0) continue;
+        sortArray[sortCount].name = slot->name;
+        sortArray[sortCount].record = &slot->record;
+        sortArray[sortCount].histogram = ws->histograms != NULL ? ws->histograms[i] : NULL;
+        sortCount++;
+    }
+
+    qsort(sortArray, sortCount, sizeof(NamedRecord), cmpStationName);
+    *count = sortCount;
+    return sortArray;
+}
+
+void printStations(const NamedRecord* stations, int count) {
+    for (int i = 0; i < count; i++) {
+        const NamedRecord* st = &stations[i];
+        double mean = (double)st->record->totalTemp / st->record->numRecords / 10.0;
+        if (st->histogram != NULL) {
+            printf("%s=%.1f/%.1f/%.1f/%.1f/%.1f/%.1f\n", st->name, st->record->minTemp / 10.0, mean, st->record->maxTemp / 10.0,
+                histogramPercentile(st->histogram, st->record->numRecords, 50),
+                histogramPercentile(st->histogram, st->record->numRecords, 95),
+                histogramPercentile(st->histogram, st->record->numRecords, 99));
+        } else {
+            printf("%s=%.1f/%.1f/%.1f\n", st->name, st->record->minTemp / 10.0, mean, st->record->maxTemp / 10.0);
+        }
+    }
+}
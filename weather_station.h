@@ -0,0 +1,298 @@
+#ifndef WEATHER_STATION_H
+#define WEATHER_STATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// vector compares for names over 16 bytes, picked by -march
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// temperatures are fixed point tenths of a degree, -99.9..99.9 fits in int16 and the
+// integer sum is exact, so results don't depend on the order rows are added in
+typedef struct TemperatureRecord {
+    int16_t minTemp;
+    int16_t maxTemp;
+    uint32_t numRecords;
+    int64_t totalTemp;
+} TemperatureRecord;
+
+// bump pointer arena for station names, names are packed next to each other in
+// blocks and every block is released at once when the table is freed
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t used;
+    size_t capacity;
+    char data[];
+} ArenaBlock;
+
+typedef struct NameArena {
+    ArenaBlock* head;
+} NameArena;
+
+#define NAME_ARENA_BLOCK_SIZE (64 * 1024)
+// arena names are zero padded to a multiple of this, at least one \0 after every name
+#define NAME_PAD 16
+
+// one slot of the open addressing table, hash and length are checked before the name
+// so most mismatches never touch the string, and the stats sit in the same cache line
+typedef struct StationSlot {
+    uint32_t hash;
+    uint32_t length; // 0 marks an empty slot, station names are never empty
+    char* name;
+    TemperatureRecord record;
+} StationSlot;
+
+// collision free table over a known station dictionary (hash and displace), a name from the
+// dictionary is found with one bucket lookup and one compare, no probing, and the table is
+// sized to the dictionary so it stays in L1 instead of spreading over the general slab
+// bucket = (hash * PERFECT_BUCKET_MULTIPLIER) >> bucketShift
+// slot = ((hash ^ displace[bucket]) * PERFECT_SLOT_MULTIPLIER) >> slotShift
+typedef struct PerfectIndex {
+    uint32_t bucketShift;
+    uint32_t slotShift;
+    uint32_t* displace;
+    StationSlot* slots; // the dictionary stations live here, not in the general table
+    int size;
+} PerfectIndex;
+
+// hot path counters, only compiled in with -DBRC_STATS so the normal build pays nothing
+// every table counts for itself and mergeWeatherStation adds them up with the records
+#ifdef BRC_STATS
+typedef struct HotCounters {
+    uint64_t rows;
+    uint64_t bytesParsed;
+    uint64_t newStations;
+    uint64_t probes;      // slots looked at by findStation
+    uint64_t collisions;  // of those, slots holding another name
+    uint64_t perfectHits; // rows answered by the dictionary table
+} HotCounters;
+#define COUNT_HOT(ws, field, n) ((ws)->counters.field += (n))
+#else
+#define COUNT_HOT(ws, field, n) ((void)0)
+#endif
+
+// percentile mode: a count per tenth of a degree from -99.9 to 99.9 for every station, merged
+// by adding bucket by bucket and exact for any quantile, kept beside the slots rather than in
+// them so the 32 byte slot is the same with the mode off
+#define HISTOGRAM_BUCKETS 1999
+#define HISTOGRAM_OFFSET 999 // temp goes into bucket temp + HISTOGRAM_OFFSET
+// 10k stations make 80MB of histograms hit in random order, they are carved out of 2MB arena
+// blocks advised for huge pages so a row's bucket costs a cache miss but rarely a TLB miss
+#define HISTOGRAM_BLOCK_SIZE (2 << 20)
+
+#define PERFECT_BUCKET_MULTIPLIER 0x85EBCA6Bu
+#define PERFECT_SLOT_MULTIPLIER 0x9E3779B1u
+
+typedef struct WeatherStation {
+    StationSlot* slots; // fixed slab, allocated once up front, records live inline
+    int count; // stations in slots and in perfect
+    int capacity; // always a power of two, index = hash & (capacity - 1)
+    NameArena names;
+    PerfectIndex* perfect; // NULL unless a station dictionary was loaded
+    // NULL unless percentiles are on, one per slot in stationSlotAt order, a station's
+    // histogram is allocated from histogramArena on its first row
+    uint32_t** histograms;
+    NameArena histogramArena;
+#ifdef BRC_STATS
+    HotCounters counters;
+#endif
+} WeatherStation;
+
+// 1BRC has at most 10k unique stations, keep the table under half full for them
+#define STATION_TABLE_CAPACITY (1 << 15)
+
+typedef struct {
+    char* name;
+    TemperatureRecord* record;
+    const uint32_t* histogram; // NULL unless percentiles are on
+} NamedRecord;
+
+void initWeatherStation(WeatherStation* ws, int capacity);
+void freeWeatherStation(WeatherStation* ws);
+
+// turns on the per station histograms, after loadStationDictionary since the dictionary
+// slots get histograms too
+void enablePercentiles(WeatherStation* ws);
+// slow path of countTemperature, a zeroed histogram for the slot at index
+uint32_t* allocHistogram(WeatherStation* ws, int index);
+
+// a private table for a worker thread, with the same capacity, dictionary and percentile mode as main
+void initWeatherStationLike(WeatherStation* ws, const WeatherStation* main);
+
+// copies a name into the arena, zero padded to NAME_PAD bytes so it is also a C string
+// for sorting and printing and nameEquals can load whole words of it
+char* arenaCopyName(NameArena* arena, const char* name, uint32_t length);
+
+// slow path of addStation, claims a slot for a new name (growing the table if needed)
+// and copies the name into the arena, the returned record is zeroed
+StationSlot* insertStation(WeatherStation* ws, const char* name, uint32_t length, uint32_t hash);
+
+// folds one station's record into dst, inserting the name if dst hasn't seen it, returns
+// the station's slot in dst
+StationSlot* mergeStation(WeatherStation* dst, const char* name, uint32_t length, uint32_t hash, const TemperatureRecord* record);
+
+// folds src into dst, names are copied so src can be freed afterwards
+void mergeWeatherStation(WeatherStation* dst, const WeatherStation* src);
+
+// rows aggregated, the sum of every station's count
+uint64_t countRecords(const WeatherStation* ws);
+
+// the stations with rows sorted by name, *count of them, the array is the caller's to free,
+// sorting and printing are separate so the caller can time each
+NamedRecord* sortStations(const WeatherStation* ws, int* count);
+// name=min/mean/max for each, with percentiles on name=min/mean/max/p50/p95/p99
+void printStations(const NamedRecord* stations, int count);
+
+// perfect_hash.c: reads one station name per line and builds the perfect table over them,
+// names outside the dictionary still go through the general table
+int loadStationDictionary(WeatherStation* ws, const char* path);
+// gives dst the same dictionary stations and layout as src, with no rows yet
+void clonePerfectIndex(WeatherStation* dst, const WeatherStation* src);
+void freePerfectIndex(PerfectIndex* perfect);
+
+// walks every slot that may hold a station, the general table first then the dictionary
+static inline int stationSlotCount(const WeatherStation* ws) {
+    return ws->capacity + (ws->perfect != NULL ? ws->perfect->size : 0);
+}
+
+static inline StationSlot* stationSlotAt(const WeatherStation* ws, int i) {
+    return i < ws->capacity ? &ws->slots[i] : &ws->perfect->slots[i - ws->capacity];
+}
+
+// the stationSlotAt index of a slot of the general table or the dictionary
+static inline int stationSlotIndex(const WeatherStation* ws, const StationSlot* slot) {
+    if ((uintptr_t)slot - (uintptr_t)ws->slots < (uintptr_t)ws->capacity * sizeof(StationSlot)) {
+        return (int)(slot - ws->slots);
+    }
+    return ws->capacity + (int)(slot - ws->perfect->slots);
+}
+
+static inline uint32_t* stationHistogram(WeatherStation* ws, const StationSlot* slot) {
+    int index = stationSlotIndex(ws, slot);
+    uint32_t* histogram = ws->histograms[index];
+    return histogram != NULL ? histogram : allocHistogram(ws, index);
+}
+
+// FNV-1a over the name bytes
+static inline uint32_t hashName(const char* name, uint32_t length) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// compares a table name (zero padded, see arenaCopyName) with length bytes of the input
+// up to 16 bytes: two 8 byte words of the input with the bytes past the name masked off,
+// equal to the padded table words only if the names are equal, no branch on the length
+// longer: 16 (SSE2) or 32 (AVX2) byte xors ORed together and tested once, a candidate with the
+// same hash and length nearly always matches so an early exit wouldn't pay, the last load
+// ends at length and overlaps the one before it so neither side is read past the name
+static inline int nameEquals(const char* stored, const char* name, uint32_t length) {
+    if (length <= 16) {
+        // the masked words may read up to 15 bytes past the name, fine while they stay in its
+        // page (a load can't fault inside a mapped page), near the end of a page use memcmp
+        if (((uintptr_t)name & 4095) > 4096 - 16) return memcmp(stored, name, length) == 0;
+        uint64_t in0, in1, table0, table1;
+        memcpy(&in0, name, 8);
+        memcpy(&in1, name + 8, 8);
+        memcpy(&table0, stored, 8);
+        memcpy(&table1, stored + 8, 8);
+        // 16 bytes of 0xFF then 16 of 0, the masks for length start 16 - length bytes in
+        static const unsigned char nameMasks[32] = { 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255 };
+        uint64_t mask0, mask1;
+        memcpy(&mask0, nameMasks + 16 - length, 8);
+        memcpy(&mask1, nameMasks + 24 - length, 8);
+        return (((in0 & mask0) ^ table0) | ((in1 & mask1) ^ table1)) == 0;
+    }
+#if defined(__AVX2__)
+    if (length >= 32) {
+        __m256i diff = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(stored + length - 32)), _mm256_loadu_si256((const __m256i*)(name + length - 32)));
+        for (uint32_t i = 0; i + 32 < length; i += 32) {
+            diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(stored + i)), _mm256_loadu_si256((const __m256i*)(name + i))));
+        }
+        return _mm256_testz_si256(diff, diff);
+    }
+#endif
+#if defined(__SSE2__)
+    __m128i diff = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(stored + length - 16)), _mm_loadu_si128((const __m128i*)(name + length - 16)));
+    for (uint32_t i = 0; i + 16 < length; i += 16) {
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i*)(stored + i)), _mm_loadu_si128((const __m128i*)(name + i))));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xFFFF;
+#else
+    return memcmp(stored, name, length) == 0;
+#endif
+}
+
+// linear probing, returns the slot holding name or the empty slot where it should go
+static inline StationSlot* findStation(const WeatherStation* ws, const char* name, uint32_t hash, uint32_t length) {
+    uint32_t mask = (uint32_t)ws->capacity - 1;
+    uint32_t index = hash & mask;
+    while (1) {
+        StationSlot* slot = &ws->slots[index];
+        // the counters are the only thing a lookup writes, the table itself is never const
+        COUNT_HOT((WeatherStation*)ws, probes, 1);
+        if (slot->length == 0) {
+            return slot;
+        }
+        // cheap integer checks first, the name compare only runs on a real candidate
+        if (slot->hash == hash && slot->length == length && nameEquals(slot->name, name, length)) {
+            return slot;
+        }
+        COUNT_HOT((WeatherStation*)ws, collisions, 1);
+        index = (index + 1) & mask;
+    }
+}
+
+// the only slot a dictionary name can be in, it may hold another name or none
+static inline StationSlot* findPerfectStation(const PerfectIndex* perfect, uint32_t hash) {
+    uint32_t bucket = (hash * PERFECT_BUCKET_MULTIPLIER) >> perfect->bucketShift;
+    return &perfect->slots[((hash ^ perfect->displace[bucket]) * PERFECT_SLOT_MULTIPLIER) >> perfect->slotShift];
+}
+
+// dictionary first, then the general table, an empty slot means the name is new
+static inline StationSlot* lookupStation(const WeatherStation* ws, const char* name, uint32_t hash, uint32_t length) {
+    if (ws->perfect != NULL) {
+        StationSlot* slot = findPerfectStation(ws->perfect, hash);
+        if (slot->hash == hash && slot->length == length && nameEquals(slot->name, name, length)) {
+            COUNT_HOT((WeatherStation*)ws, perfectHits, 1);
+            return slot;
+        }
+    }
+    return findStation(ws, name, hash, length);
+}
+
+// the hot path, inline so every backend's row loop avoids a call per row
+// name is a (pointer, length) view and need not be NUL terminated, it is copied only on first insert
+static inline void addStation(WeatherStation* ws, const char* name, uint32_t length, int temp) {
+    uint32_t hash = hashName(name, length);
+    COUNT_HOT(ws, rows, 1);
+
+    // dictionary stations start with min/max primed, so their first row takes the update path
+    StationSlot* slot = lookupStation(ws, name, hash, length);
+    TemperatureRecord* existingRecord = &slot->record;
+    if (slot->length == 0) {
+        slot = insertStation(ws, name, length, hash);
+        existingRecord = &slot->record;
+        existingRecord->maxTemp = temp;
+        existingRecord->minTemp = temp;
+        existingRecord->totalTemp = temp;
+        existingRecord->numRecords = 1;
+    } else {
+        existingRecord->minTemp = existingRecord->minTemp < temp ? existingRecord->minTemp : temp;
+        existingRecord->maxTemp = existingRecord->maxTemp > temp ? existingRecord->maxTemp : temp;
+        existingRecord->totalTemp += temp;
+        existingRecord->numRecords++;
+    }
+    // one well predicted branch when percentiles are off
+    if (ws->histograms != NULL) {
+        stationHistogram(ws, slot)[temp + HISTOGRAM_OFFSET]++;
+    }
+}
+
+#endif
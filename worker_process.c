@@ -0,0 +1,84 @@
+#include <stdio.h>
+
+#include <unistd.h> // fork, pipe, _exit
+#include <sys/wait.h> // waitpid
+
+#include "worker_process.h"
+#include "snapshot.h"
+#include "stats.h"
+
+// never returns, the exit status tells the parent whether a whole table was written
+static void runChild(const IoBackend* backend, const IoOptions* options, WeatherStation* ws, const char* snapshotPath, int out) {
+    IoOptions childOptions = *options;
+    childOptions.keepMapping = 1;
+    int failed = snapshotPath != NULL ? runWithSnapshot(backend, &childOptions, ws, snapshotPath) : runBackend(backend, &childOptions, ws);
+
+    FILE* pipeOut = failed ? NULL : fdopen(out, "wb");
+    if (!failed && (pipeOut == NULL || writeWeatherStation(pipeOut, ws) != 0 || fclose(pipeOut) != 0)) {
+        perror("worker process: sending the table failed");
+        failed = 1;
+    }
+
+    // exit tears the mappings down before it closes the files, a reader of the parent's
+    // output (brc | sort) would wait for that too if the child still held stdout or stderr
+    close(STDOUT_FILENO);
+    close(STDERR_FILENO);
+    // no munmap, no free, the kernel drops the whole address space at once
+    _exit(failed);
+}
+
+int runInWorkerProcess(const IoBackend* backend, const IoOptions* options, WeatherStation* ws, const char* snapshotPath, int waitForChild) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe failed");
+        return 1;
+    }
+
+    // whatever is still buffered would be written by both processes
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork failed");
+        close(fds[0]);
+        close(fds[1]);
+        return 1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        runChild(backend, options, ws, snapshotPath, fds[1]);
+    }
+    close(fds[1]);
+
+    // as seen from here the scan is the wait for the first byte and the merge is reading the table
+    enterPhase(PHASE_SCAN);
+    FILE* in = fdopen(fds[0], "rb");
+    if (in == NULL) {
+        perror("fdopen failed");
+        close(fds[0]);
+        waitpid(pid, NULL, 0);
+        return 1;
+    }
+    int first = fgetc(in);
+    enterPhase(PHASE_MERGE);
+    int failed = first == EOF || ungetc(first, in) == EOF || readWeatherStation(in, ws) != 0;
+    fclose(in);
+
+    if (failed) {
+        // a child that failed printed why before exiting, one that was killed didn't
+        int status;
+        if (waitpid(pid, &status, 0) == pid && WIFSIGNALED(status)) {
+            fprintf(stderr, "worker process killed by signal %d\n", WTERMSIG(status));
+        } else {
+            fprintf(stderr, "worker process failed\n");
+        }
+        return 1;
+    }
+    // inherited perf counters are added to this process's when the child exits and RUSAGE_CHILDREN
+    // only counts reaped children, so a report waits for the teardown, charged to the merge
+    if (waitForChild) {
+        waitpid(pid, NULL, 0);
+    }
+    // otherwise not waited for, the child's teardown overlaps printing the results and this process's exit
+    return 0;
+}
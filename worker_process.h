@@ -0,0 +1,18 @@
+#ifndef WORKER_PROCESS_H
+#define WORKER_PROCESS_H
+
+#include "io_backend.h"
+
+// unmapping a file of many GB and tearing the process down costs a visible share of the
+// wall time after the results are known, here a forked child maps and aggregates, sends its
+// table back over a pipe in the snapshot format and exits without unmapping anything, the
+// parent never maps the file, so it prints and exits while the kernel is still cleaning up
+// the child
+
+// runs backend over options->paths (resuming from snapshotPath like runWithSnapshot when it isn't NULL) in a
+// child process and merges the child's table into ws, returns 0 on success, the child is
+// only waited for when it failed or with waitForChild, which --perf and --stats need: the
+// child's counters and resource usage only reach this process once it has been reaped
+int runInWorkerProcess(const IoBackend* backend, const IoOptions* options, WeatherStation* ws, const char* snapshotPath, int waitForChild);
+
+#endif